@@ -0,0 +1,38 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+// SNTP-disciplined wall clock.
+//
+// Every SNTP sync records a (monotonic, UTC) pair. UTC is then derived from
+// esp_timer_get_time() through that anchor, corrected by a drift estimate
+// learned from successive syncs. Timestamps stay monotonic between syncs
+// even when SNTP steps the system clock. When a resync finds the local
+// clock ahead, clockNowUtcMs() holds its value until real time catches up
+// (up to 2 s; a larger error is corrected with a backward step).
+
+#include <stdint.h>
+
+struct ClockSyncStatus {
+  bool synced;
+  uint32_t syncCount;
+  int64_t lastOffsetMs;     // prediction error at the last sync (UTC - predicted)
+  float driftPpm;           // local oscillator drift estimate
+  uint32_t lastSyncAgeMs;
+};
+
+// Start SNTP against the given servers (defaults: pool.ntp.org, time.google.com)
+void clockSyncBegin(const char* server1 = "pool.ntp.org", const char* server2 = "time.google.com");
+
+bool clockSynced();
+
+// Current UTC in milliseconds since the epoch, 0 until the first sync.
+// Never goes backwards across a resync, see above.
+uint64_t clockNowUtcMs();
+
+// Map a monotonic esp_timer_get_time() value to UTC milliseconds, through
+// the current anchor (no hold)
+uint64_t clockMonoToUtcMs(int64_t monoUs);
+
+ClockSyncStatus clockSyncStatus();
+
+#endif // CLOCK_SYNC_H
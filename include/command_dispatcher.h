@@ -0,0 +1,52 @@
+#ifndef COMMAND_DISPATCHER_H
+#define COMMAND_DISPATCHER_H
+
+// MQTT command dispatcher for runtime-tunable parameters.
+//
+// Every parameter is reachable at <prefix>/<name>. Its payload is a plain
+// decimal number, parsed in place from the MQTT receive buffer (no String).
+// Topic suffixes are looked up in an open-addressing hash table built once
+// at startup. Accepted values are persisted to NVS (Preferences namespace
+// "station") and applied immediately through the parameter's onApply hook.
+//
+// <prefix>/reset restores every parameter to its compiled default.
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct CommandParam;
+
+typedef void (*CommandApplyHook)(const CommandParam& param);
+
+struct CommandParam {
+  const char* name;         // topic suffix and NVS key (max 15 chars)
+  uint32_t* value;          // live value used by the firmware
+  uint32_t minValue;
+  uint32_t maxValue;
+  CommandApplyHook onApply; // optional, called after every change
+};
+
+enum CommandStatus {
+  COMMAND_OK = 0,
+  COMMAND_NOT_MINE,       // topic outside the command prefix
+  COMMAND_UNKNOWN,        // no parameter with that name
+  COMMAND_BAD_PAYLOAD,    // not a decimal number
+  COMMAND_OUT_OF_RANGE
+};
+
+struct CommandResult {
+  CommandStatus status;
+  const CommandParam* param; // nullptr for reset / errors before lookup
+  uint32_t value;
+};
+
+// Load persisted values over the compiled defaults, apply them and build
+// the lookup table. params must outlive the dispatcher.
+bool commandDispatcherBegin(const char* topicPrefix, CommandParam* params, uint8_t count);
+
+// Handle one inbound message. Safe to call with any topic.
+CommandResult commandDispatch(const char* topic, const uint8_t* payload, unsigned int length);
+
+const char* commandStatusToString(CommandStatus status);
+
+#endif // COMMAND_DISPATCHER_H
@@ -0,0 +1,90 @@
+#ifndef COORD_CODEC_H
+#define COORD_CODEC_H
+
+// Compact stream encoding for ISS coordinate samples.
+//
+// Each frame starts with one header byte: bit 7 set = keyframe, bits 0-6 =
+// sequence number (mod 128). A keyframe carries absolute zig-zag varints for
+// latitude and longitude (in 1e-4 degree units, the API precision) and a plain
+// varint Unix timestamp. A delta frame carries the zig-zag varint difference
+// of each field from the previous sample. Frames are self-delimiting, so
+// several can be concatenated into one MQTT history payload.
+//
+// This file has no Arduino dependency so the decoder can be built on a host:
+//   g++ -Iinclude -c src/coord_codec.cpp
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-point scale: 1 unit = 1e-4 degree (open-notify returns 4 decimals)
+const int32_t COORD_CODEC_SCALE = 10000;
+
+// Worst case frame size: header + 3 varints of at most 5 bytes
+const size_t COORD_CODEC_MAX_FRAME = 1 + 5 + 5 + 5;
+
+struct CoordSample {
+  int32_t latE4;      // latitude * 1e4
+  int32_t lonE4;      // longitude * 1e4
+  uint32_t timestamp; // Unix timestamp (s)
+};
+
+enum CoordDecodeResult {
+  COORD_DECODE_OK = 0,
+  COORD_DECODE_TRUNCATED,     // not enough bytes for a full frame
+  COORD_DECODE_NEED_KEYFRAME, // delta received without a valid reference
+  COORD_DECODE_MALFORMED      // varint too long
+};
+
+// Conversion helpers between degrees and the fixed-point representation
+int32_t coordToFixed(float degrees);
+float coordFromFixed(int32_t fixed);
+
+// Low level varint primitives (exposed for other binary payloads)
+size_t varintWrite(uint32_t value, uint8_t* out, size_t cap);
+size_t varintRead(const uint8_t* in, size_t len, uint32_t* value);
+inline uint32_t zigzagEncode(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t zigzagDecode(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+class CoordStreamEncoder {
+public:
+  // keyframeInterval: emit a keyframe at least every N frames (1 = always)
+  explicit CoordStreamEncoder(uint8_t keyframeInterval = 16);
+
+  // Encode one sample into out. Returns bytes written, 0 if cap is too small.
+  size_t encode(const CoordSample& sample, uint8_t* out, size_t cap);
+
+  // Make the next frame a keyframe (e.g. new consumer, start of a batch)
+  void forceKeyframe() { framesSinceKey = keyframeInterval; }
+
+  uint8_t sequence() const { return seq; }
+
+private:
+  uint8_t keyframeInterval;
+  uint8_t framesSinceKey;
+  uint8_t seq;
+  bool haveRef;
+  CoordSample ref;
+};
+
+class CoordStreamDecoder {
+public:
+  CoordStreamDecoder();
+
+  // Decode one frame from in. On OK, *consumed is the frame size and *sample
+  // is filled. On NEED_KEYFRAME, *consumed is still set so the caller can
+  // skip the frame and keep scanning for the next keyframe.
+  CoordDecodeResult decode(const uint8_t* in, size_t len, CoordSample* sample, size_t* consumed);
+
+  void reset() { haveRef = false; }
+
+  // Frames dropped because a sequence gap invalidated the reference
+  uint32_t droppedFrames() const { return dropped; }
+
+private:
+  bool haveRef;
+  uint8_t lastSeq;
+  uint32_t dropped;
+  CoordSample ref;
+};
+
+#endif // COORD_CODEC_H
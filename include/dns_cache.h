@@ -0,0 +1,52 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+// Resolver cache shared by the HTTP and MQTT transports.
+//
+// lwIP's resolver does not expose record TTLs, so A queries are sent
+// directly over UDP to the DHCP-provided DNS servers. Answers are cached for
+// their TTL. dnsCacheLoop() refreshes entries shortly before they expire, so
+// connects rarely wait on DNS. When the resolver is unreachable, the
+// last-known-good address is used. Replies are only accepted from the
+// queried server, with a random query id and a matching question.
+
+#include <WiFiClient.h>
+
+const uint8_t DNS_CACHE_SIZE = 8;
+const uint32_t DNS_MIN_TTL_S = 30;
+const uint32_t DNS_MAX_TTL_S = 86400;
+const uint32_t DNS_QUERY_TIMEOUT_MS = 1500;
+const uint32_t DNS_REFRESH_AHEAD_MS = 15000; // refresh this long before expiry
+const uint32_t DNS_LWIP_WAIT_MS = 4000;       // lwIP fallback, not interruptible
+const uint32_t DNS_RESOLVE_WAIT_MS = 2 * DNS_QUERY_TIMEOUT_MS + DNS_LWIP_WAIT_MS;
+
+struct DnsCacheStats {
+  uint32_t hits;          // fresh entry
+  uint32_t misses;        // blocking query needed
+  uint32_t refreshes;     // background refreshes completed
+  uint32_t staleServed;   // resolver failed, last-known-good used
+  uint32_t failures;      // nothing to return
+  uint32_t rejected;      // replies not matching the pending query (server, id, question)
+};
+
+// Resolve host (dotted IPs are parsed directly). Returns false only when
+// neither the resolver nor the cache can provide an address within waitMs,
+// which includes waiting for the cache lock. The lwIP fallback is skipped
+// when less than DNS_LWIP_WAIT_MS is left.
+bool dnsCacheResolve(const char* host, IPAddress& ip, uint32_t waitMs = DNS_RESOLVE_WAIT_MS);
+
+// Process replies and launch refreshes for entries about to expire
+void dnsCacheLoop();
+
+const DnsCacheStats& dnsCacheStats();
+
+// WiFiClient that resolves hostnames through the cache before connecting.
+// With a timeout, it covers the resolve and the TCP connect together.
+class DnsCachedClient : public WiFiClient {
+public:
+  using WiFiClient::connect;
+  int connect(const char* host, uint16_t port) override;
+  int connect(const char* host, uint16_t port, int32_t timeout) override;
+};
+
+#endif // DNS_CACHE_H
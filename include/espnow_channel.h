@@ -0,0 +1,74 @@
+#ifndef ESPNOW_CHANNEL_H
+#define ESPNOW_CHANNEL_H
+
+// Keeps ESP-NOW peers on the radio's current channel.
+//
+// A station associated with an AP transmits on the AP's channel, and
+// esp_now_send() fails for any peer registered on another one. After a
+// reconnect to an AP on a different channel (roam, AP channel change), all
+// peers are re-registered on the new channel. Changes are detected from the
+// STA_CONNECTED event, with a once-per-second WiFi.channel() check as a
+// fallback for in-place channel switches.
+//
+// Frames sent between a channel change and the first delivered frame after
+// it are counted as lost, along with the time that recovery took.
+//
+// Nodes that are not associated with the AP do not know which channel the
+// others use. They can run the discovery handshake: hop channels 1..13 and
+// send an ESPNOW_FRAME_PROBE to the peer on each one, until it answers with
+// an ESPNOW_FRAME_CHANNEL frame. Every node running this module answers
+// probes. A prober that is not already a peer is answered through a
+// temporary peer entry, removed right after, so a gateway can answer any
+// number of stations without filling the ESP-NOW peer table.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_now.h>
+
+const uint8_t ESPNOW_CHANNEL_MAX_PEERS = 8;     // peers this node sends data to
+const uint8_t ESPNOW_PROBE_QUEUE_DEPTH = 4;     // probes waiting for loop() to answer
+const uint8_t ESPNOW_CHANNEL_MAX = 13;
+const uint16_t ESPNOW_DISCOVERY_DWELL_MS = 60; // wait for a reply on each channel
+
+struct EspNowChannelStats {
+  uint8_t channel;            // channel the peers are registered on
+  uint32_t channelChanges;
+  uint32_t reregistrations;   // esp_now_mod_peer calls after a change
+  uint32_t framesLost;        // failed sends between a change and recovery
+  uint32_t lastRecoveryMs;    // change detected -> first delivered frame
+  uint32_t maxRecoveryMs;
+  uint32_t probesAnswered;
+  uint32_t probesDropped;     // probe queue full (written by the WiFi task only)
+  uint32_t discoveries;       // handshakes that found the peer
+  uint32_t discoveryFailures;
+};
+
+// Register the Wi-Fi event handlers. esp_now_init() must already have
+// succeeded.
+void espnowChannelBegin();
+
+// Register a peer on the current channel (or update it)
+bool espnowChannelAddPeer(const uint8_t* mac);
+
+// Apply a pending channel change, then esp_now_send()
+esp_err_t espnowChannelSend(const uint8_t* mac, const uint8_t* data, size_t len);
+
+// Call from the ESP-NOW send callback
+void espnowChannelOnSent(const uint8_t* mac, esp_now_send_status_t status);
+
+// Call from the ESP-NOW receive callback. Returns true if the frame was a
+// discovery frame and was consumed.
+bool espnowChannelOnRecv(const uint8_t* mac, const uint8_t* data, int len);
+
+// Apply channel changes and answer probes. Call from loop().
+void espnowChannelLoop();
+
+// Discovery handshake, for a node not associated with an AP. Blocks up to
+// 13 * dwellMs. Returns the channel the peer answered on (peers are moved
+// there), or 0 if it never answered. While associated, returns the AP's
+// channel without probing: the radio cannot leave it.
+uint8_t espnowChannelDiscover(const uint8_t* mac, uint16_t dwellMs = ESPNOW_DISCOVERY_DWELL_MS);
+
+const EspNowChannelStats& espnowChannelStats();
+
+#endif // ESPNOW_CHANNEL_H
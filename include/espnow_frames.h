@@ -0,0 +1,37 @@
+#ifndef ESPNOW_FRAMES_H
+#define ESPNOW_FRAMES_H
+
+// ESP-NOW payload framing. Every frame starts with an EspNowFrameHeader:
+// a type byte so a receiver can tell the payload kinds apart, and a
+// per-sender sequence number so a gateway can drop MAC-level retries.
+
+#include <stdint.h>
+
+enum EspNowFrameType : uint8_t {
+  ESPNOW_FRAME_COORD = 'C',      // coord_codec frame follows
+  ESPNOW_FRAME_RANGE_STATS = 'D', // RangeStatsFrame follows
+  ESPNOW_FRAME_PROBE = 'P',       // channel discovery request, no body
+  ESPNOW_FRAME_CHANNEL = 'H'      // discovery reply: ChannelFrame follows
+};
+
+struct __attribute__((packed)) EspNowFrameHeader {
+  uint8_t type;  // EspNowFrameType
+  uint16_t seq;  // incremented for every frame a station sends
+};
+
+// Windowed ultrasonic distance statistics (little endian, packed)
+struct __attribute__((packed)) RangeStatsFrame {
+  uint16_t minMm;
+  uint16_t maxMm;
+  uint16_t meanMm;
+  uint16_t p50Mm;
+  uint16_t samples;  // decimated samples in the window
+  uint16_t rejected; // raw samples dropped (timeout / out of range)
+};
+
+// Reply to a probe: the channel the responder is listening on
+struct __attribute__((packed)) ChannelFrame {
+  uint8_t channel;
+};
+
+#endif // ESPNOW_FRAMES_H
@@ -0,0 +1,72 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+// ESP-NOW aggregation gateway.
+//
+// The receive callback copies each frame into a FreeRTOS queue; gatewayLoop()
+// drains it, drops duplicates per sender (32-frame sliding sequence window on
+// EspNowFrameHeader::seq) and packs the survivors into one MQTT batch:
+//
+//   [u8 record count] then per record: [6-byte sender MAC][u8 len][frame]
+//
+// A batch is flushed when it is full or GATEWAY_BATCH_MAX_AGE_MS old, so N
+// stations share the gateway's single broker connection. A batch that fails
+// to publish is kept and retried; meanwhile new frames wait in the queue,
+// and those that overflow it are counted in queueDrops.
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint8_t GATEWAY_MAX_SENDERS = 64;
+const uint16_t GATEWAY_QUEUE_DEPTH = 64;
+const size_t GATEWAY_BATCH_BYTES = 1024;
+const uint32_t GATEWAY_BATCH_MAX_AGE_MS = 500;
+const uint32_t GATEWAY_PUBLISH_RETRY_MS = 1000;      // after a failed publish, keep the batch and wait
+const uint32_t GATEWAY_SENDER_IDLE_RESET_MS = 30000; // forget seq window after silence (sender reboot)
+const uint32_t GATEWAY_SENDER_EVICT_MS = 300000;     // free the sender slot after this much silence
+const int16_t GATEWAY_SEQ_RESTART_GAP = 32;          // seq this far behind the window = sender restarted
+
+// Sliding anti-duplicate window over a 16-bit sequence
+struct SeqWindow {
+  uint16_t highest;
+  uint32_t bitmap; // bit i = highest - i already seen
+  bool valid;
+};
+
+// Returns true if seq is new, false if it was already seen or is too old.
+// gatewayLoop() resets the window first when seq is GATEWAY_SEQ_RESTART_GAP
+// or more behind it, since duplicates never lag that far.
+bool seqWindowAccept(SeqWindow& window, uint16_t seq);
+
+struct GatewayStats {
+  uint32_t framesReceived;   // handed to the gateway by the radio (or bench)
+  uint32_t framesAccepted;
+  uint32_t duplicates;
+  uint32_t malformed;        // shorter than a frame header
+  uint32_t queueDrops;       // queue full in the receive callback
+  uint32_t senderTableFull;  // frames from a sender beyond GATEWAY_MAX_SENDERS
+  uint32_t sendersEvicted;   // slots freed after GATEWAY_SENDER_EVICT_MS of silence
+  uint32_t senderRestarts;   // sequence jumped back, window reset
+  uint32_t publishes;
+  uint32_t publishFailures;
+  uint32_t publishedBytes;
+  uint8_t activeSenders;
+};
+
+typedef bool (*GatewayPublishFn)(const uint8_t* payload, size_t len);
+
+// Create the queue and register the ESP-NOW receive callback.
+// esp_now_init() must already have succeeded.
+bool gatewayBegin();
+
+// Queue one frame as if it came from the radio. Used by the receive
+// callback and by the simulated-sender benchmark.
+bool gatewayInject(const uint8_t* mac, const uint8_t* data, int len);
+
+// Drain the queue, deduplicate, batch, and publish through publish().
+void gatewayLoop(GatewayPublishFn publish);
+
+// Snapshot of the counters (updated from both the radio task and loop)
+GatewayStats gatewayStats();
+
+#endif // GATEWAY_H
@@ -0,0 +1,85 @@
+#ifndef HTTP_ASYNC_H
+#define HTTP_ASYNC_H
+
+// Concurrent HTTP requests on a small pool of worker tasks.
+//
+// httpAsyncRunAll() queues a batch of independent requests, the workers run
+// them in parallel over pooled keep-alive connections (transport_pool.h),
+// and the call returns once every request has completed. A cycle that
+// polls several APIs then takes as long as its slowest request, instead of
+// the sum of all of them.
+//
+//   HttpAsyncRequest requests[2] = {{"GET", urlA}, {"POST", urlB, json}};
+//   httpAsyncRunAll(requests, 2);
+//   if (requests[1].status == 200) ... requests[1].response ...
+//
+// Requests must stay valid until httpAsyncRunAll() returns. The hooks run on
+// a worker task, so they may only touch data the caller is not using while
+// it waits.
+//
+// A batch has one deadline, HTTP_ASYNC_BATCH_MS after it starts. Workers
+// clamp the pool wait, connect (DNS, TCP and TLS handshake together) and
+// read timeouts to the time left, and a request still queued at the deadline
+// fails without being sent, so the call returns around the deadline
+// whatever the servers do.
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+const uint8_t HTTP_ASYNC_WORKERS = 3;          // requests in flight at once
+const uint8_t HTTP_ASYNC_QUEUE_DEPTH = 8;
+const uint32_t HTTP_ASYNC_TIMEOUT_MS = 10000;  // HTTPClient read timeout per request
+const uint32_t HTTP_ASYNC_ACQUIRE_MS = 5000;   // wait for a pooled connection
+const uint32_t HTTP_ASYNC_CONNECT_MS = 5000;   // TCP connect (and TLS handshake)
+const uint32_t HTTP_ASYNC_BATCH_MS = 15000;    // whole batch, see above
+
+struct HttpAsyncRequest;
+
+typedef void (*HttpAsyncHook)(HttpAsyncRequest& request, HTTPClient& http);
+
+struct HttpAsyncRequest {
+  // Input
+  const char* method;        // "GET", "POST", "PUT", "DELETE", ...
+  const char* url;
+  const char* body;          // nullptr = no body
+  const char* authToken;     // sent as "Authorization: Bearer <token>" if set
+  const char* contentType;   // for the body, default application/json
+  HttpAsyncHook onPrepare;   // before sending: extra headers, collectHeaders()
+  HttpAsyncHook onResponse;  // after the status line, before the body is read
+  void* context;
+
+  // Output
+  int status;                // HTTP status, or HTTPC_ERROR_* (< 0)
+  String response;
+  uint32_t elapsedMs;
+  volatile bool done;
+  TaskHandle_t waiter;       // task notified on completion
+  unsigned long deadlineMillis; // end of the batch
+};
+
+struct HttpAsyncStats {
+  uint32_t requests;
+  uint32_t failures;         // status < 0
+  uint32_t deadlineMisses;   // cut short by the batch deadline
+  uint32_t batches;
+  uint32_t lastBatchMs;      // wall time of the last batch
+  uint32_t lastBatchSumMs;   // what it would have taken one request at a time
+};
+
+// Create the queue and the worker tasks. Called on first use if needed.
+bool httpAsyncBegin();
+
+// Run count requests concurrently and wait until all are done, at most
+// HTTP_ASYNC_BATCH_MS. Returns the number that got an HTTP response
+// (status > 0).
+size_t httpAsyncRunAll(HttpAsyncRequest* requests, size_t count);
+
+inline bool httpAsyncRun(HttpAsyncRequest& request) {
+  return httpAsyncRunAll(&request, 1) == 1;
+}
+
+const HttpAsyncStats& httpAsyncStats();
+
+#endif // HTTP_ASYNC_H
@@ -0,0 +1,170 @@
+#ifndef MQTT_ASYNC_H
+#define MQTT_ASYNC_H
+
+// MQTT 3.1.1 client that runs on its own network task.
+//
+// publish() only copies the packet into a preallocated pool buffer and
+// queues it, so loop() never waits on the broker. The network task does all
+// socket I/O:
+// - connects and reconnects with capped exponential backoff;
+// - keeps the session alive;
+// - sends queued packets;
+// - keeps up to a window of QoS 1 PUBLISHes in flight, each waiting for its
+//   PUBACK, so several messages share one round trip.
+//
+// With a persistent session (cleanSession = false), messages still unacked
+// when the link drops are resent with DUP set after the reconnect. QoS 1
+// messages queued while offline are held until the pool fills up.
+//
+// Received messages are handed to the callback from client.loop(), like
+// PubSubClient, so handlers never run on the network task. The method names
+// and state codes match PubSubClient so callers change little.
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+const uint8_t MQTT_ASYNC_POOL_SIZE = 12;       // packet buffers, shared by both directions
+const uint16_t MQTT_ASYNC_PACKET_SIZE = 640;   // largest packet (header + topic + payload)
+const uint8_t MQTT_ASYNC_MAX_INFLIGHT = 8;     // upper bound for the QoS 1 window
+const uint8_t MQTT_ASYNC_MAX_SUBSCRIPTIONS = 4;
+const uint32_t MQTT_ASYNC_ACK_TIMEOUT_MS = 20000; // no PUBACK for this long: reconnect
+
+// PubSubClient-compatible state codes
+const int MQTT_ASYNC_CONNECTION_TIMEOUT = -4;
+const int MQTT_ASYNC_CONNECTION_LOST = -3;
+const int MQTT_ASYNC_CONNECT_FAILED = -2;
+const int MQTT_ASYNC_DISCONNECTED = -1;
+const int MQTT_ASYNC_CONNECTED = 0;
+
+typedef void (*MqttAsyncCallback)(char* topic, uint8_t* payload, unsigned int length);
+
+struct MqttAsyncStats {
+  uint32_t connects;
+  uint32_t sessionsResumed;  // CONNACK with session present
+  uint32_t published;        // PUBLISH packets written (QoS 0 and 1)
+  uint32_t acked;            // PUBACKs received
+  uint32_t resent;           // DUP retransmissions after a reconnect
+  uint32_t dropped;          // pool exhausted, oversized, or QoS 0 while offline
+  uint32_t received;         // PUBLISHes from the broker
+  uint32_t ackRttMsTotal;    // sum of PUBLISH -> PUBACK times
+  uint8_t inflight;          // QoS 1 currently awaiting PUBACK
+  uint8_t queued;            // waiting for a window slot or the connection
+};
+
+class MqttAsyncClient {
+public:
+  explicit MqttAsyncClient(WiFiClient& transport);
+
+  void setServer(const char* host, uint16_t port);
+  void setCallback(MqttAsyncCallback callback);
+  // Window of unacknowledged QoS 1 PUBLISHes, 1..MQTT_ASYNC_MAX_INFLIGHT
+  void setInflightWindow(uint8_t window);
+  void setKeepAlive(uint16_t seconds);
+
+  // Start the network task. The client id must be stable for the broker to
+  // keep a persistent session. user may be null or empty.
+  bool begin(const char* clientId, const char* user, const char* password, bool cleanSession = false);
+
+  bool connected() const { return isConnected; }
+  int state() const { return connState; }
+
+  // Queue a PUBLISH. Returns false if the pool is exhausted, the packet is
+  // too large, or (QoS 0 only) the client is offline.
+  bool publish(const char* topic, const char* payload, uint8_t qos = 1);
+  bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos = 1);
+
+  // Remembered and re-sent whenever the broker has no session for us
+  bool subscribe(const char* filter, uint8_t qos = 0);
+
+  // Deliver received messages to the callback. Call from loop().
+  void loop();
+
+  MqttAsyncStats stats() const;
+
+  // Outbound messages not yet written or still waiting for their PUBACK
+  uint8_t pending() const;
+
+private:
+  enum BufferState : uint8_t { BUF_FREE = 0, BUF_OUTBOUND, BUF_INFLIGHT, BUF_INBOUND };
+
+  struct Buffer {
+    BufferState state;
+    uint8_t qos;
+    uint16_t packetId;
+    uint16_t length;
+    uint16_t topicLength;    // inbound: topic is NUL terminated at data[0]
+    uint16_t idOffset;       // outbound QoS 1: where the packet id goes
+    unsigned long sentMillis;
+    uint8_t data[MQTT_ASYNC_PACKET_SIZE];
+  };
+
+  struct Subscription {
+    char filter[64];
+    uint8_t qos;
+    bool sent;
+  };
+
+  static void taskEntry(void* arg);
+  void run();
+  bool connectBroker();
+  void dropConnection(int newState);
+  bool writePacket(const uint8_t* data, size_t length);
+  void sendControl(uint8_t type, uint16_t packetId);
+  void readIncoming();
+  void handlePacket(uint8_t header, const uint8_t* body, size_t length);
+  void sendQueued();
+  void sendSubscriptions();
+  void checkTimers();
+
+  int allocBuffer();
+  void freeBuffer(int index);
+  uint16_t nextPacketId();
+
+  WiFiClient& transport;
+  const char* host;
+  uint16_t port;
+  const char* clientId;
+  const char* user;
+  const char* password;
+  bool cleanSession;
+  uint16_t keepAliveS;
+  uint8_t window;
+  MqttAsyncCallback callback;
+
+  TaskHandle_t task;
+  QueueHandle_t outQueue;   // buffer indices, app -> network task
+  QueueHandle_t inQueue;    // buffer indices, network task -> app
+  mutable portMUX_TYPE mux; // guards the buffer states and subscriptions
+
+  Buffer pool[MQTT_ASYNC_POOL_SIZE];
+  Subscription subscriptions[MQTT_ASYNC_MAX_SUBSCRIPTIONS];
+  uint8_t subscriptionCount;
+
+  // Network task only
+  int8_t waiting[MQTT_ASYNC_POOL_SIZE];  // QoS 1 FIFO waiting for a window slot
+  uint8_t waitingCount;
+  int8_t inflight[MQTT_ASYNC_MAX_INFLIGHT]; // in send order
+  uint8_t inflightCount;
+  uint16_t lastPacketId;
+  unsigned long lastSendMillis;
+  unsigned long pingSentMillis;
+  bool pingOutstanding;
+  uint32_t backoffMs;
+  unsigned long nextAttemptMillis;
+  enum RxStage : uint8_t { RX_HEADER, RX_LENGTH, RX_BODY };
+  RxStage rxStage;
+  uint8_t rxHeader;
+  uint8_t rxLengthShift;
+  uint32_t rxLength;         // body length of the current packet
+  uint32_t rxFilled;         // body bytes received so far
+  uint8_t rxBuffer[MQTT_ASYNC_PACKET_SIZE];
+
+  volatile bool isConnected;
+  volatile int connState;
+  MqttAsyncStats counters;
+};
+
+#endif // MQTT_ASYNC_H
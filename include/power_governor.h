@@ -0,0 +1,72 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+// CPU frequency and Wi-Fi modem-sleep governor.
+//
+// The station does real work for a few ms every 2-10 s. Between bursts the
+// CPU runs at the minimum clock and the modem sleeps between DTIM beacons
+// (WIFI_PS_MIN_MODEM), so it wakes only when the AP may have buffered
+// traffic. A PowerBurst scope around fetch, parse and publish raises the
+// clock to the maximum and keeps the modem awake, so HTTP responses and
+// publishes are not delayed by DTIM buffering.
+//
+// With esp_pm available (CONFIG_PM_ENABLE), esp_pm handles frequency
+// scaling and a burst holds an ESP_PM_CPU_FREQ_MAX lock. Otherwise
+// esp_pm_configure() fails and the governor switches the clock itself with
+// setCpuFrequencyMhz().
+//
+// Time spent in each state is accounted. Energy is estimated from nominal
+// ESP32 datasheet currents: good enough to compare settings, not a meter.
+
+#include <stdint.h>
+
+const uint32_t POWER_DEFAULT_MAX_MHZ = 240;
+const uint32_t POWER_DEFAULT_MIN_MHZ = 80;  // lowest clock Wi-Fi runs at
+
+// Nominal supply current per state (mA) at 3.3 V
+const uint32_t POWER_BURST_MA = 100; // max clock, radio awake
+const uint32_t POWER_IDLE_MA = 25;   // min clock, DTIM modem sleep (average)
+const uint32_t POWER_FULL_MA = 95;   // governor off: max clock, radio always listening
+const uint32_t POWER_SUPPLY_MV = 3300;
+
+enum PowerMode : uint8_t {
+  POWER_MODE_NONE = 0, // not started
+  POWER_MODE_PM,       // esp_pm dynamic frequency scaling + PM lock
+  POWER_MODE_MANUAL    // setCpuFrequencyMhz() fallback
+};
+
+struct PowerStats {
+  uint8_t mode;         // PowerMode
+  bool enabled;         // false: held at full clock, modem awake
+  uint32_t maxMhz;
+  uint32_t minMhz;
+  uint32_t bursts;
+  uint64_t burstMs;     // max clock, modem awake
+  uint64_t idleMs;      // min clock, modem sleep
+  uint64_t fullMs;      // governor disabled
+  uint64_t energyUj;    // estimated from the nominal currents
+};
+
+// Configure frequency scaling and modem sleep. Call once Wi-Fi is up.
+bool powerGovernorBegin(uint32_t maxMhz = POWER_DEFAULT_MAX_MHZ, uint32_t minMhz = POWER_DEFAULT_MIN_MHZ);
+
+// Disabled: full clock and no modem sleep all the time (for comparisons).
+// May be called before powerGovernorBegin().
+void powerGovernorEnable(bool enabled);
+
+void powerBurstBegin();
+void powerBurstEnd();
+
+// RAII helper: PowerBurst burst(workDue); nested bursts are counted once
+struct PowerBurst {
+  explicit PowerBurst(bool active = true) : active(active) { if (active) powerBurstBegin(); }
+  ~PowerBurst() { if (active) powerBurstEnd(); }
+  bool active;
+};
+
+// Counters, with the current state accounted up to now
+PowerStats powerGovernorStats();
+
+const char* powerModeName(uint8_t mode);
+
+#endif // POWER_GOVERNOR_H
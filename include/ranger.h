@@ -0,0 +1,50 @@
+#ifndef RANGER_H
+#define RANGER_H
+
+// Non-blocking HC-SR04 ranging.
+//
+// An esp_timer fires the trigger pulse at a fixed rate and a GPIO interrupt
+// on the echo pin timestamps both edges, so nothing ever busy-waits like
+// pulseIn(). Echo widths land in a lock-free ring buffer; rangerLoop()
+// drains it from loop(), applies a median-of-5 filter, decimates, and
+// closes a statistics window every RANGER_WINDOW_SAMPLES decimated samples.
+
+#include <stdint.h>
+
+const uint8_t RANGER_TRIGGER_PIN = 5;
+const uint8_t RANGER_ECHO_PIN = 6;
+
+const uint32_t RANGER_SAMPLE_PERIOD_US = 50000; // 20 Hz trigger rate
+const uint8_t RANGER_DECIMATION = 4;            // keep 1 of 4 filtered samples
+const uint8_t RANGER_WINDOW_SAMPLES = 25;       // 25 * 4 / 20 Hz = 5 s window
+
+const uint16_t RANGER_MIN_MM = 20;   // below sensor blind zone
+const uint16_t RANGER_MAX_MM = 4000; // above sensor range
+
+struct RangeStats {
+  uint16_t minMm;
+  uint16_t maxMm;
+  uint16_t meanMm;
+  uint16_t p50Mm;
+  uint16_t samples;         // decimated samples in the window
+  uint16_t rejected;        // raw samples dropped in the window
+  unsigned long windowEndMillis;
+};
+
+struct RangerCounters {
+  uint32_t rawSamples;
+  uint32_t timeouts;        // no echo before the next trigger
+  uint32_t outOfRange;
+  uint32_t overflows;       // ring buffer full, sample lost
+  uint32_t windows;
+};
+
+// Configure pins, attach the echo interrupt and start the trigger timer
+bool rangerBegin();
+
+// Drain pending echoes. Returns true and fills *stats when a window closed.
+bool rangerLoop(RangeStats* stats);
+
+const RangerCounters& rangerCounters();
+
+#endif // RANGER_H
@@ -0,0 +1,159 @@
+#ifndef REST_POLLER_H
+#define REST_POLLER_H
+
+// Schema-driven REST poller.
+//
+// Each endpoint declares a URL, a poll period and a field schema mapping a
+// dotted JSON path ("iss_position.latitude") to a member of a plain record
+// struct. Paths are hashed at compile time (FNV-1a), so one pass over the
+// response body fills the record without building any String per key.
+//
+//   struct IssNow { char message[16]; float latitude; float longitude; unsigned long timestamp; };
+//   static constexpr RestField issNowFields[] = {
+//     REST_FIELD(IssNow, message, "message"),
+//     REST_FIELD(IssNow, latitude, "iss_position.latitude"),
+//     ...
+//   };
+//   REST_SCHEMA_CHECK(issNowFields);
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ========== Compile-time path hashing ==========
+
+constexpr uint32_t REST_HASH_BASIS = 2166136261u;
+
+constexpr uint32_t restHashStep(uint32_t h, char c) {
+  return (h ^ (uint8_t)c) * 16777619u;
+}
+
+constexpr uint32_t restPathHash(const char* s, uint32_t h = REST_HASH_BASIS) {
+  return *s ? restPathHash(s + 1, restHashStep(h, *s)) : h;
+}
+
+// ========== Field schema ==========
+
+enum RestFieldType : uint8_t {
+  REST_FLOAT,
+  REST_DOUBLE,
+  REST_INT,    // signed integer, 4 or 8 bytes
+  REST_UINT,   // unsigned integer, 4 or 8 bytes
+  REST_BOOL,
+  REST_STRING  // char[N], always NUL terminated
+};
+
+template <typename T> struct RestTypeOf;
+template <> struct RestTypeOf<float> { static constexpr RestFieldType value = REST_FLOAT; };
+template <> struct RestTypeOf<double> { static constexpr RestFieldType value = REST_DOUBLE; };
+template <> struct RestTypeOf<int> { static constexpr RestFieldType value = REST_INT; };
+template <> struct RestTypeOf<long> { static constexpr RestFieldType value = REST_INT; };
+template <> struct RestTypeOf<long long> { static constexpr RestFieldType value = REST_INT; };
+template <> struct RestTypeOf<unsigned> { static constexpr RestFieldType value = REST_UINT; };
+template <> struct RestTypeOf<unsigned long> { static constexpr RestFieldType value = REST_UINT; };
+template <> struct RestTypeOf<unsigned long long> { static constexpr RestFieldType value = REST_UINT; };
+template <> struct RestTypeOf<bool> { static constexpr RestFieldType value = REST_BOOL; };
+template <size_t N> struct RestTypeOf<char[N]> { static constexpr RestFieldType value = REST_STRING; };
+
+struct RestField {
+  uint32_t pathHash;
+  RestFieldType type;
+  uint16_t offset; // offset of the destination member in the record
+  uint16_t size;   // sizeof the destination member
+  const char* path;
+};
+
+// Type and size are derived from the record member, so a schema entry can
+// never write the wrong type into the record
+#define REST_FIELD(Record, member, path)                                    \
+  { restPathHash(path), RestTypeOf<decltype(((Record*)0)->member)>::value,  \
+    (uint16_t)offsetof(Record, member),                                     \
+    (uint16_t)sizeof(((Record*)0)->member), path }
+
+// Compile-time schema validation: at most 32 fields (found mask is 32 bits)
+// and no two paths hashing to the same value
+constexpr bool restSchemaUniqueFrom(const RestField* f, size_t n, size_t i, size_t j) {
+  return i >= n ? true
+       : j >= n ? restSchemaUniqueFrom(f, n, i + 1, i + 2)
+       : f[i].pathHash == f[j].pathHash ? false
+       : restSchemaUniqueFrom(f, n, i, j + 1);
+}
+
+template <size_t N>
+constexpr bool restSchemaValid(const RestField (&fields)[N]) {
+  return N <= 32 && restSchemaUniqueFrom(fields, N, 0, 1);
+}
+
+#define REST_SCHEMA_CHECK(fields) \
+  static_assert(restSchemaValid(fields), #fields ": too many fields or duplicate path hash")
+
+#define REST_SCHEMA_COUNT(fields) ((uint8_t)(sizeof(fields) / sizeof((fields)[0])))
+
+// ========== Extraction ==========
+
+// One pass over json, storing every scalar whose path is in the schema.
+// Values inside arrays are skipped. Returns a bitmask of the fields found
+// (bit i = fields[i]).
+uint32_t restExtract(const char* json, size_t len, const RestField* fields, uint8_t fieldCount, void* record);
+
+// Serialize a record back to flat JSON using the schema (leaf key names).
+// Returns the length written, 0 if buf is too small.
+size_t restRecordToJson(const RestField* fields, uint8_t fieldCount, const void* record, char* buf, size_t cap);
+
+// Runtime FNV-1a hash of a response body, used to detect unchanged content
+uint32_t restBodyHash(const char* body, size_t len);
+
+// Parse a Cache-Control header value. Returns max-age in seconds, 0 for
+// no-cache / no-store, -1 when the header gives no freshness information.
+long restParseMaxAge(const char* cacheControl);
+
+// ========== Poller ==========
+
+struct RestEndpoint;
+
+// Called after each successful extraction with the mask of fields found
+typedef void (*RestRecordHandler)(RestEndpoint& endpoint, uint32_t foundMask);
+
+struct RestEndpoint {
+  const char* name;
+  const char* url;
+  uint32_t periodMs;
+  const RestField* fields;
+  uint8_t fieldCount;
+  void* record;
+  size_t recordSize;
+  RestRecordHandler onRecord;
+
+  // Runtime state, managed by the poller
+  struct State {
+    unsigned long lastPollMillis;
+    uint32_t freshForMs;       // from Cache-Control max-age minus Age
+    char etag[64];             // sent back as If-None-Match
+    char lastModified[40];     // sent back as If-Modified-Since
+    uint32_t bodyHash;         // hash of the last parsed body
+    bool haveBody;
+    uint32_t pollCount;
+    uint32_t errorCount;
+    uint32_t notModifiedCount; // 304 responses
+    uint32_t unchangedCount;   // 200 responses with an identical body
+  } state;
+};
+
+#define REST_ENDPOINT(name, url, periodMs, fields, record, handler) \
+  { name, url, periodMs, fields, REST_SCHEMA_COUNT(fields), &(record), sizeof(record), handler, {} }
+
+// Effective poll interval: the configured period, stretched to the
+// server's freshness lifetime when that is longer
+uint32_t restEffectivePeriodMs(const RestEndpoint& endpoint);
+
+// True if restPollerLoop() would poll at least one endpoint now
+bool restPollerDue(const RestEndpoint* endpoints, size_t count);
+
+// Poll every endpoint whose period has elapsed. Due endpoints are fetched
+// concurrently (http_async.h), then parsed in order. Call from loop().
+void restPollerLoop(RestEndpoint* endpoints, size_t count);
+
+// Fetch one endpoint now, regardless of its period. Returns true if a
+// record was extracted and handed to onRecord.
+bool restPollEndpoint(RestEndpoint& endpoint);
+
+#endif // REST_POLLER_H
@@ -0,0 +1,71 @@
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+// Append-only, time-indexed ISS sample log on the "samplelog" flash partition.
+//
+// The partition is a ring of 4 KB sectors. Each sector holds a 16-byte header
+// (magic, sequence number) followed by 255 fixed-size 16-byte records in
+// timestamp order. Writing wraps around the ring and erases the oldest sector
+// to reuse it, so every sector is erased equally often (wear leveling). With a
+// 1 MB partition that is 65280 samples, about 7.5 days at one sample per 10 s.
+//
+// The sparse index is the first timestamp of each sector. It is rebuilt in RAM
+// at boot from the sector headers. A range query binary-searches the index,
+// then the records inside one sector, so it reads O(log n) records before it
+// streams anything.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "coord_codec.h"
+
+struct SampleLogRecord {
+  uint32_t timestamp; // Unix timestamp (s), 0xFFFFFFFF = erased
+  int32_t latE4;
+  int32_t lonE4;
+  uint16_t rxDelayMs; // API capture -> local receive, clamped, 0 = unknown
+  uint8_t marker;
+  uint8_t crc;        // CRC-8 of the first 15 bytes
+};
+
+static_assert(sizeof(SampleLogRecord) == 16, "SampleLogRecord must stay 16 bytes");
+
+// Read position for a range query
+struct SampleLogCursor {
+  uint16_t sector;  // physical sector
+  uint16_t record;  // record index within the sector
+  uint32_t seq;     // sequence number the sector must still have
+  uint32_t toTs;    // last timestamp included
+  bool done;
+};
+
+struct SampleLogStats {
+  uint32_t sectors;      // sectors in the partition
+  uint32_t sectorsUsed;
+  uint32_t records;      // records currently stored
+  uint32_t capacity;     // records the partition can hold
+  uint32_t oldestTs;     // 0 when empty
+  uint32_t newestTs;
+  uint32_t appends;      // since boot
+  uint32_t appendErrors;
+  uint32_t erases;       // since boot
+};
+
+// Find and mount the partition (formats it on first use). Returns false if
+// the partition table has no "samplelog" partition; the log is then disabled.
+bool sampleLogBegin(const char* label = "samplelog");
+
+// Append one sample. Timestamps must increase; older or repeated ones are
+// rejected.
+bool sampleLogAppend(const CoordSample& sample, uint32_t rxDelayMs);
+
+// Position a cursor on the first record with timestamp >= fromTs.
+// Returns false if the log is empty or disabled.
+bool sampleLogSeek(uint32_t fromTs, uint32_t toTs, SampleLogCursor* cursor);
+
+// Read up to max records from the cursor. Returns the count read, 0 once the
+// range is exhausted (or the sector under the cursor was recycled).
+size_t sampleLogRead(SampleLogCursor* cursor, SampleLogRecord* out, size_t max);
+
+const SampleLogStats& sampleLogStats();
+
+#endif // SAMPLE_LOG_H
@@ -0,0 +1,79 @@
+#ifndef STALL_MONITOR_H
+#define STALL_MONITOR_H
+
+// Loop stall profiler and watchdog.
+//
+// Each loop() stage runs inside a StallScope with a time budget. Overruns
+// are recorded (stage, elapsed, uptime). The active stage is also mirrored
+// into RTC memory, so if the task watchdog resets the chip mid-stage, the
+// next boot still knows which stage hung. The last STALL_LOG_SIZE records
+// survive software and watchdog resets (not power loss) and are reported
+// once after reboot.
+//
+// Scopes nest: an inner stage is charged its own time and the outer stage
+// resumes when it ends, without the inner time. The watchdog is fed at
+// every stage boundary, so its timeout only has to cover the longest stage
+// budget, not a whole loop().
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum StallStage : uint8_t {
+  STAGE_NONE = 0,
+  STAGE_WIFI,
+  STAGE_MQTT,
+  STAGE_REST,
+  STAGE_RANGER,
+  STAGE_ESPNOW,
+  STAGE_DNS,
+  STAGE_PUBLISH,
+  STAGE_HTTP,
+  STAGE_COUNT
+};
+
+const uint8_t STALL_LOG_SIZE = 8;
+const uint32_t STALL_WATCHDOG_TIMEOUT_S = 30;
+
+struct StallRecord {
+  uint8_t stage;       // StallStage
+  uint8_t watchdog;    // 1 = the stage never finished, chip was reset
+  uint16_t boot;       // boot number the stall happened in
+  uint32_t elapsedMs;  // time spent in the stage (to reset, for watchdog records)
+  uint32_t uptimeS;
+};
+
+// Load the RTC log, account for a watchdog reset, arm the task watchdog
+// for the calling (loop) task. Call at the end of setup().
+void stallMonitorBegin();
+
+// Feed the watchdog. Call once per loop() iteration.
+void stallLoopTick();
+
+// The stage a nested scope interrupted, restored when it ends
+struct StallOuter {
+  uint8_t stage;
+  unsigned long startMillis;
+};
+
+StallOuter stallStageBegin(StallStage stage);
+void stallStageEnd(const StallOuter& outer);
+
+// RAII helper: StallScope scope(STAGE_REST);
+struct StallScope {
+  explicit StallScope(StallStage stage) : outer(stallStageBegin(stage)) {}
+  ~StallScope() { stallStageEnd(outer); }
+  StallOuter outer;
+};
+
+const char* stallStageName(uint8_t stage);
+
+// True until the stall report has been published once after boot
+bool stallReportPending();
+// The report was delivered: clear the RTC log so the next boot does not
+// publish the same records again
+void stallReportDone();
+
+// JSON summary of the reset reason and the RTC stall log
+size_t stallFormatReport(char* buf, size_t cap);
+
+#endif // STALL_MONITOR_H
@@ -0,0 +1,72 @@
+#ifndef TLS_TRANSPORT_H
+#define TLS_TRANSPORT_H
+
+// TLS client transport with session resumption.
+//
+// Unlike WiFiClientSecure, which parses the CA and runs a full handshake on
+// every connect, TlsTransport shares one parsed CA chain, one RNG and one
+// mbedtls_ssl_config across all connections. It keeps the last session per
+// host:port and offers it on reconnect (session ID or session ticket), so a
+// reconnect costs an abbreviated handshake. Handshakes from different tasks
+// run in parallel. It derives from WiFiClient, so it drops into
+// HTTPClient::begin(client, url) and PubSubClient unchanged.
+//
+// The CA chain comes from TLS_CA_CERT (PEM) in secrets.h.
+
+#include <WiFiClient.h>
+#include <mbedtls/ssl.h>
+#include "dns_cache.h"
+
+struct TlsStats {
+  uint32_t fullHandshakes;
+  uint32_t resumedHandshakes;
+  uint32_t failedHandshakes;
+  uint32_t fullHandshakeMsTotal;
+  uint32_t resumedHandshakeMsTotal;
+  uint32_t lastHandshakeMs;
+  uint32_t reusedConnections; // requests served on an already open connection
+};
+
+class TlsTransport : public WiFiClient {
+public:
+  TlsTransport();
+  ~TlsTransport();
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(IPAddress ip, uint16_t port, int32_t timeout) override;
+  int connect(const char* host, uint16_t port) override;
+  int connect(const char* host, uint16_t port, int32_t timeout) override;
+
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override;
+
+  // Upper bound for the handshake alone; connect(..., timeout) also bounds
+  // DNS, TCP and handshake together
+  void setHandshakeTimeout(uint32_t ms) { handshakeTimeoutMs = ms; }
+
+private:
+  bool handshake(const char* host, uint16_t port, uint32_t timeoutMs);
+  static int bioSend(void* ctx, const unsigned char* buf, size_t len);
+  static int bioRecv(void* ctx, unsigned char* buf, size_t len);
+
+  DnsCachedClient tcp;
+  mbedtls_ssl_context ssl;
+  bool sslActive;
+  int peekByte; // -1 = none
+  uint32_t handshakeTimeoutMs;
+};
+
+// Snapshot of the counters shared by every TlsTransport
+TlsStats tlsStats();
+
+// Called by the transport pool when a request rides an open connection
+void tlsNoteReusedConnection();
+
+#endif // TLS_TRANSPORT_H
@@ -0,0 +1,37 @@
+#ifndef TRANSPORT_POOL_H
+#define TRANSPORT_POOL_H
+
+// Bounded pool of persistent HTTP transports.
+//
+// HTTPClient normally creates and tears down its own connection on every
+// request. Handing it a client from this pool (with setReuse(true)) keeps
+// the connection open across polls when the server allows keep-alive, and
+// keeps TLS sessions warm for https:// URLs.
+//
+// A client is checked out for one request and returned afterwards, so
+// concurrent requests (http_async.h) never share a socket. A host may hold
+// several connections while requests run, but only one stays open once they
+// are released. At most TRANSPORT_POOL_SIZE exist at once: when all are
+// busy, transportAcquire() waits for one to be released.
+
+#include <WiFiClient.h>
+
+const uint8_t TRANSPORT_POOL_SIZE = 6;
+const uint32_t TRANSPORT_ACQUIRE_WAIT_MS = 15000;
+
+// Check out a client for the scheme/host/port of url: TlsTransport for
+// https, plain DnsCachedClient otherwise (both resolve through dns_cache.h).
+// An idle connection to the same host is preferred; otherwise a new one is
+// created, replacing the least recently used idle connection if the pool is
+// full. Returns nullptr if the URL is malformed or nothing was released
+// within waitMs. The client stays owned by the pool.
+WiFiClient* transportAcquire(const char* url, uint32_t waitMs = TRANSPORT_ACQUIRE_WAIT_MS);
+
+// Return a client from transportAcquire(). Its connection stays open for
+// the next request to the same host; older idle ones to that host are closed.
+void transportRelease(WiFiClient* client);
+
+// Split an http(s) URL. host must hold at least 64 bytes.
+bool transportParseUrl(const char* url, bool* secure, char* host, size_t hostCap, uint16_t* port);
+
+#endif // TRANSPORT_POOL_H
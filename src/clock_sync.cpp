@@ -0,0 +1,95 @@
+#include <Arduino.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include "clock_sync.h"
+
+// Re-sync every 15 minutes so drift never accumulates past a few ms
+static const uint32_t SYNC_INTERVAL_MS = 15 * 60 * 1000;
+
+// A resync that finds the local clock ahead by up to this much holds the
+// time instead of stepping back; larger errors are corrected with a step
+static const int64_t MAX_HOLD_US = 2000 * 1000LL;
+
+// Anchor written from the SNTP callback (lwIP task), read from loop()
+static portMUX_TYPE anchorMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t anchorMonoUs = 0;
+static int64_t anchorUtcUs = 0;
+static double driftPpm = 0.0;
+static bool synced = false;
+static uint32_t syncCount = 0;
+static int64_t lastOffsetUs = 0;
+static int64_t lastNowUtcUs = 0; // highest time handed out by clockNowUtcMs()
+
+static int64_t predictUtcUs(int64_t monoUs) {
+  int64_t elapsed = monoUs - anchorMonoUs;
+  return anchorUtcUs + elapsed + (int64_t)(elapsed * driftPpm / 1e6);
+}
+
+static void onTimeSync(struct timeval* tv) {
+  int64_t monoUs = esp_timer_get_time();
+  int64_t utcUs = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+
+  portENTER_CRITICAL(&anchorMux);
+  if (synced) {
+    // Prediction error over the elapsed interval refines the drift estimate
+    int64_t elapsed = monoUs - anchorMonoUs;
+    lastOffsetUs = utcUs - predictUtcUs(monoUs);
+    if (elapsed > 60 * 1000000LL) {
+      double correctionPpm = (double)lastOffsetUs * 1e6 / elapsed;
+      driftPpm += 0.5 * correctionPpm; // smooth out network jitter
+    }
+  }
+  anchorMonoUs = monoUs;
+  anchorUtcUs = utcUs;
+  if (lastNowUtcUs - utcUs > MAX_HOLD_US) lastNowUtcUs = 0; // too far off to hold: step
+  synced = true;
+  syncCount++;
+  portEXIT_CRITICAL(&anchorMux);
+
+  Serial.printf("[CLOCK] SNTP sync #%lu, offset %lld ms, drift %.1f ppm\n",
+                (unsigned long)syncCount, lastOffsetUs / 1000, driftPpm);
+}
+
+void clockSyncBegin(const char* server1, const char* server2) {
+  sntp_set_time_sync_notification_cb(onTimeSync);
+  sntp_set_sync_interval(SYNC_INTERVAL_MS);
+  configTime(0, 0, server1, server2); // UTC, no DST
+  Serial.print("[CLOCK] SNTP started: ");
+  Serial.print(server1); Serial.print(", "); Serial.println(server2);
+}
+
+bool clockSynced() {
+  return synced;
+}
+
+uint64_t clockMonoToUtcMs(int64_t monoUs) {
+  if (!synced) return 0;
+  portENTER_CRITICAL(&anchorMux);
+  int64_t utcUs = predictUtcUs(monoUs);
+  portEXIT_CRITICAL(&anchorMux);
+  return (uint64_t)(utcUs / 1000);
+}
+
+uint64_t clockNowUtcMs() {
+  if (!synced) return 0;
+  portENTER_CRITICAL(&anchorMux);
+  int64_t utcUs = predictUtcUs(esp_timer_get_time());
+  // Hold until real time catches up with what was already handed out
+  if (utcUs < lastNowUtcUs) utcUs = lastNowUtcUs;
+  else lastNowUtcUs = utcUs;
+  portEXIT_CRITICAL(&anchorMux);
+  return (uint64_t)(utcUs / 1000);
+}
+
+ClockSyncStatus clockSyncStatus() {
+  ClockSyncStatus status;
+  portENTER_CRITICAL(&anchorMux);
+  status.synced = synced;
+  status.syncCount = syncCount;
+  status.lastOffsetMs = lastOffsetUs / 1000;
+  status.driftPpm = (float)driftPpm;
+  status.lastSyncAgeMs = synced ? (uint32_t)((esp_timer_get_time() - anchorMonoUs) / 1000) : 0;
+  portEXIT_CRITICAL(&anchorMux);
+  return status;
+}
@@ -0,0 +1,159 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "command_dispatcher.h"
+#include "rest_poller.h" // restHashStep: same FNV-1a as the REST schemas
+
+static const uint8_t MAX_PARAMS = 16;
+static const uint8_t TABLE_SIZE = 32; // power of two, > 2 * MAX_PARAMS
+
+static Preferences prefs;
+static const char* prefix = nullptr;
+static size_t prefixLen = 0;
+static CommandParam* params = nullptr;
+static uint8_t paramCount = 0;
+static uint32_t defaults[MAX_PARAMS];
+
+// Slot holds param index + 1, 0 = empty
+static uint8_t table[TABLE_SIZE];
+static uint32_t tableHash[TABLE_SIZE];
+
+static uint32_t hashName(const char* s, size_t len) {
+  uint32_t h = REST_HASH_BASIS;
+  for (size_t i = 0; i < len; i++) h = restHashStep(h, s[i]);
+  return h;
+}
+
+static void tableInsert(uint8_t index) {
+  const char* name = params[index].name;
+  uint32_t h = hashName(name, strlen(name));
+  uint8_t slot = h & (TABLE_SIZE - 1);
+  while (table[slot] != 0) slot = (slot + 1) & (TABLE_SIZE - 1);
+  table[slot] = index + 1;
+  tableHash[slot] = h;
+}
+
+static CommandParam* tableLookup(const char* name, size_t len) {
+  uint32_t h = hashName(name, len);
+  uint8_t slot = h & (TABLE_SIZE - 1);
+  while (table[slot] != 0) {
+    CommandParam& p = params[table[slot] - 1];
+    if (tableHash[slot] == h && strlen(p.name) == len && memcmp(p.name, name, len) == 0) {
+      return &p;
+    }
+    slot = (slot + 1) & (TABLE_SIZE - 1);
+  }
+  return nullptr;
+}
+
+// Decimal parse straight from the payload buffer (surrounding spaces allowed)
+static bool parseUint(const uint8_t* payload, unsigned int length, uint32_t* out) {
+  unsigned int i = 0;
+  while (i < length && payload[i] == ' ') i++;
+  if (i == length) return false;
+
+  uint64_t v = 0;
+  unsigned int digits = 0;
+  for (; i < length && payload[i] >= '0' && payload[i] <= '9'; i++, digits++) {
+    v = v * 10 + (payload[i] - '0');
+    if (v > UINT32_MAX) return false;
+  }
+  while (i < length && (payload[i] == ' ' || payload[i] == '\r' || payload[i] == '\n')) i++;
+  if (digits == 0 || i != length) return false;
+
+  *out = (uint32_t)v;
+  return true;
+}
+
+static void applyParam(const CommandParam& p) {
+  if (p.onApply) p.onApply(p);
+}
+
+bool commandDispatcherBegin(const char* topicPrefix, CommandParam* list, uint8_t count) {
+  if (count > MAX_PARAMS) {
+    Serial.println("[CMD] Too many parameters");
+    return false;
+  }
+
+  prefix = topicPrefix;
+  prefixLen = strlen(topicPrefix);
+  params = list;
+  paramCount = count;
+  memset(table, 0, sizeof(table));
+
+  if (!prefs.begin("station", false)) {
+    Serial.println("[CMD] Failed to open NVS, using compiled defaults");
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    CommandParam& p = params[i];
+    defaults[i] = *p.value;
+    if (prefs.isKey(p.name)) {
+      uint32_t stored = prefs.getUInt(p.name, *p.value);
+      if (stored >= p.minValue && stored <= p.maxValue) {
+        *p.value = stored;
+      }
+    }
+    tableInsert(i);
+    applyParam(p);
+    Serial.printf("[CMD] %s = %lu%s\n", p.name, (unsigned long)*p.value,
+                  *p.value != defaults[i] ? " (from NVS)" : "");
+  }
+  return true;
+}
+
+CommandResult commandDispatch(const char* topic, const uint8_t* payload, unsigned int length) {
+  CommandResult result = {COMMAND_NOT_MINE, nullptr, 0};
+  if (params == nullptr || strncmp(topic, prefix, prefixLen) != 0 || topic[prefixLen] != '/') {
+    return result;
+  }
+
+  const char* name = topic + prefixLen + 1;
+  size_t nameLen = strlen(name);
+
+  if (nameLen == 5 && memcmp(name, "reset", 5) == 0) {
+    prefs.clear();
+    for (uint8_t i = 0; i < paramCount; i++) {
+      *params[i].value = defaults[i];
+      applyParam(params[i]);
+    }
+    result.status = COMMAND_OK;
+    return result;
+  }
+
+  CommandParam* p = tableLookup(name, nameLen);
+  if (p == nullptr) {
+    result.status = COMMAND_UNKNOWN;
+    return result;
+  }
+  result.param = p;
+
+  uint32_t value;
+  if (!parseUint(payload, length, &value)) {
+    result.status = COMMAND_BAD_PAYLOAD;
+    return result;
+  }
+  result.value = value;
+  if (value < p->minValue || value > p->maxValue) {
+    result.status = COMMAND_OUT_OF_RANGE;
+    return result;
+  }
+
+  if (*p->value != value) {
+    *p->value = value;
+    prefs.putUInt(p->name, value);
+    applyParam(*p);
+  }
+  result.status = COMMAND_OK;
+  return result;
+}
+
+const char* commandStatusToString(CommandStatus status) {
+  switch (status) {
+    case COMMAND_OK: return "ok";
+    case COMMAND_NOT_MINE: return "not_mine";
+    case COMMAND_UNKNOWN: return "unknown_parameter";
+    case COMMAND_BAD_PAYLOAD: return "bad_payload";
+    case COMMAND_OUT_OF_RANGE: return "out_of_range";
+    default: return "error";
+  }
+}
@@ -0,0 +1,115 @@
+#include "coord_codec.h"
+
+#include <math.h>
+
+int32_t coordToFixed(float degrees) {
+  return (int32_t)lroundf(degrees * COORD_CODEC_SCALE);
+}
+
+float coordFromFixed(int32_t fixed) {
+  return (float)fixed / COORD_CODEC_SCALE;
+}
+
+size_t varintWrite(uint32_t value, uint8_t* out, size_t cap) {
+  size_t n = 0;
+  do {
+    if (n >= cap) return 0;
+    uint8_t b = value & 0x7F;
+    value >>= 7;
+    out[n++] = value ? (b | 0x80) : b;
+  } while (value);
+  return n;
+}
+
+size_t varintRead(const uint8_t* in, size_t len, uint32_t* value) {
+  uint32_t result = 0;
+  for (size_t i = 0; i < len && i < 5; i++) {
+    result |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+    if ((in[i] & 0x80) == 0) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0; // truncated or longer than 5 bytes
+}
+
+// ========== Encoder ==========
+
+CoordStreamEncoder::CoordStreamEncoder(uint8_t interval)
+  : keyframeInterval(interval ? interval : 1), framesSinceKey(interval ? interval : 1),
+    seq(0), haveRef(false), ref{0, 0, 0} {}
+
+size_t CoordStreamEncoder::encode(const CoordSample& sample, uint8_t* out, size_t cap) {
+  if (cap < 1) return 0;
+
+  bool key = !haveRef || framesSinceKey >= keyframeInterval;
+  uint32_t fields[3];
+  if (key) {
+    fields[0] = zigzagEncode(sample.latE4);
+    fields[1] = zigzagEncode(sample.lonE4);
+    fields[2] = sample.timestamp;
+  } else {
+    fields[0] = zigzagEncode(sample.latE4 - ref.latE4);
+    fields[1] = zigzagEncode(sample.lonE4 - ref.lonE4);
+    fields[2] = zigzagEncode((int32_t)(sample.timestamp - ref.timestamp));
+  }
+
+  size_t n = 0;
+  out[n++] = (key ? 0x80 : 0x00) | (seq & 0x7F);
+  for (int i = 0; i < 3; i++) {
+    size_t w = varintWrite(fields[i], out + n, cap - n);
+    if (w == 0) return 0; // leave state untouched so the caller can retry
+    n += w;
+  }
+
+  ref = sample;
+  haveRef = true;
+  framesSinceKey = key ? 1 : framesSinceKey + 1;
+  seq = (seq + 1) & 0x7F;
+  return n;
+}
+
+// ========== Decoder ==========
+
+CoordStreamDecoder::CoordStreamDecoder()
+  : haveRef(false), lastSeq(0), dropped(0), ref{0, 0, 0} {}
+
+CoordDecodeResult CoordStreamDecoder::decode(const uint8_t* in, size_t len, CoordSample* sample, size_t* consumed) {
+  *consumed = 0;
+  if (len < 1) return COORD_DECODE_TRUNCATED;
+
+  bool key = (in[0] & 0x80) != 0;
+  uint8_t frameSeq = in[0] & 0x7F;
+
+  uint32_t fields[3];
+  size_t n = 1;
+  for (int i = 0; i < 3; i++) {
+    size_t r = varintRead(in + n, len - n, &fields[i]);
+    if (r == 0) {
+      return (len - n >= 5) ? COORD_DECODE_MALFORMED : COORD_DECODE_TRUNCATED;
+    }
+    n += r;
+  }
+  *consumed = n;
+
+  if (key) {
+    ref.latE4 = zigzagDecode(fields[0]);
+    ref.lonE4 = zigzagDecode(fields[1]);
+    ref.timestamp = fields[2];
+    haveRef = true;
+  } else {
+    // A gap in the sequence means we missed a delta; wait for the next keyframe
+    if (!haveRef || frameSeq != ((lastSeq + 1) & 0x7F)) {
+      haveRef = false;
+      dropped++;
+      return COORD_DECODE_NEED_KEYFRAME;
+    }
+    ref.latE4 += zigzagDecode(fields[0]);
+    ref.lonE4 += zigzagDecode(fields[1]);
+    ref.timestamp += (uint32_t)zigzagDecode(fields[2]);
+  }
+
+  lastSeq = frameSeq;
+  *sample = ref;
+  return COORD_DECODE_OK;
+}
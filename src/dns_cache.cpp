@@ -0,0 +1,337 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <esp_random.h>
+#include "dns_cache.h"
+
+struct DnsEntry {
+  char host[64];
+  IPAddress ip;               // last-known-good address
+  bool haveIp;
+  unsigned long fetchedMillis;
+  uint32_t ttlMs;
+  unsigned long lastUsedMillis;
+  uint16_t pendingId;         // 0 = no query in flight
+  IPAddress server;           // where the pending query went
+  unsigned long sentMillis;
+};
+
+static DnsEntry entries[DNS_CACHE_SIZE];
+static DnsCacheStats stats = {};
+static WiFiUDP udp;
+static bool udpReady = false;
+
+// The cache is used from loop() (HTTP) and from the MQTT network task
+static StaticSemaphore_t lockBuffer;
+static SemaphoreHandle_t lock = nullptr;
+static portMUX_TYPE lockInitMux = portMUX_INITIALIZER_UNLOCKED;
+
+struct CacheLock {
+  bool held;
+  explicit CacheLock(TickType_t wait = portMAX_DELAY) {
+    portENTER_CRITICAL(&lockInitMux);
+    if (lock == nullptr) lock = xSemaphoreCreateMutexStatic(&lockBuffer);
+    portEXIT_CRITICAL(&lockInitMux);
+    held = xSemaphoreTake(lock, wait) == pdTRUE;
+  }
+  ~CacheLock() { if (held) xSemaphoreGive(lock); }
+};
+
+// Time left of waitMs since start
+static uint32_t timeLeft(unsigned long start, uint32_t waitMs) {
+  unsigned long spent = millis() - start;
+  return spent < waitMs ? waitMs - spent : 0;
+}
+
+static bool entryFresh(const DnsEntry& e) {
+  return e.haveIp && millis() - e.fetchedMillis < e.ttlMs;
+}
+
+static DnsEntry* findEntry(const char* host, bool create) {
+  DnsEntry* empty = nullptr;
+  DnsEntry* lru = nullptr;
+  for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    DnsEntry& e = entries[i];
+    if (e.host[0] == '\0') {
+      if (empty == nullptr) empty = &e;
+    } else if (strcmp(e.host, host) == 0) {
+      return &e;
+    } else if (lru == nullptr || e.lastUsedMillis < lru->lastUsedMillis) {
+      lru = &e;
+    }
+  }
+  if (!create) return nullptr;
+
+  // Prefer an empty slot, otherwise evict the least recently used host
+  DnsEntry* victim = empty ? empty : lru;
+  memset(victim, 0, sizeof(*victim));
+  strlcpy(victim->host, host, sizeof(victim->host));
+  return victim;
+}
+
+// ========== Wire format ==========
+
+static size_t buildQuery(uint16_t id, const char* host, uint8_t* buf, size_t cap) {
+  if (cap < 12 + strlen(host) + 2 + 4) return 0;
+  memset(buf, 0, 12);
+  buf[0] = id >> 8;
+  buf[1] = id & 0xFF;
+  buf[2] = 0x01; // recursion desired
+  buf[5] = 1;    // one question
+
+  size_t n = 12;
+  const char* label = host;
+  while (*label) {
+    size_t len = strcspn(label, ".");
+    if (len == 0 || len > 63) return 0;
+    buf[n++] = (uint8_t)len;
+    memcpy(buf + n, label, len);
+    n += len;
+    label += len;
+    if (*label == '.') label++;
+  }
+  buf[n++] = 0;
+  buf[n++] = 0; buf[n++] = 1; // QTYPE A
+  buf[n++] = 0; buf[n++] = 1; // QCLASS IN
+  return n;
+}
+
+// The question is echoed uncompressed: compare it label by label, ignoring case
+static size_t matchName(const uint8_t* buf, size_t len, size_t pos, const char* host) {
+  const char* label = host;
+  while (pos < len) {
+    uint8_t l = buf[pos++];
+    if (l == 0) return *label == '\0' ? pos : 0;
+    if (l > 63 || pos + l > len) return 0;
+    size_t hostLen = strcspn(label, ".");
+    if (hostLen != l || strncasecmp((const char*)buf + pos, label, l) != 0) return 0;
+    pos += l;
+    label += l;
+    if (*label == '.') label++;
+  }
+  return 0;
+}
+
+static size_t skipName(const uint8_t* buf, size_t len, size_t pos) {
+  while (pos < len) {
+    uint8_t l = buf[pos];
+    if (l == 0) return pos + 1;
+    if ((l & 0xC0) == 0xC0) return pos + 2; // compression pointer ends the name
+    pos += l + 1;
+  }
+  return 0;
+}
+
+// Returns true with the first A record and the smallest TTL along the answer
+// chain, if the reply answers our single A question for host
+static bool parseResponse(const uint8_t* buf, size_t len, const char* host, IPAddress* ip, uint32_t* ttl) {
+  if (len < 12) return false;
+  if ((buf[2] & 0x80) == 0 || (buf[3] & 0x0F) != 0) return false; // not a response / rcode error
+
+  uint16_t qd = (buf[4] << 8) | buf[5];
+  uint16_t an = (buf[6] << 8) | buf[7];
+  if (qd != 1) return false;
+  size_t pos = matchName(buf, len, 12, host);
+  if (pos == 0 || pos + 4 > len) return false;
+  if (buf[pos] != 0 || buf[pos + 1] != 1 || buf[pos + 2] != 0 || buf[pos + 3] != 1) return false; // A, IN
+  pos += 4;
+
+  uint32_t minTtl = UINT32_MAX;
+  for (uint16_t i = 0; i < an; i++) {
+    pos = skipName(buf, len, pos);
+    if (pos == 0 || pos + 10 > len) return false;
+    uint16_t type = (buf[pos] << 8) | buf[pos + 1];
+    uint32_t recTtl = ((uint32_t)buf[pos + 4] << 24) | ((uint32_t)buf[pos + 5] << 16) | (buf[pos + 6] << 8) | buf[pos + 7];
+    uint16_t rdlen = (buf[pos + 8] << 8) | buf[pos + 9];
+    pos += 10;
+    if (pos + rdlen > len) return false;
+    if (recTtl < minTtl) minTtl = recTtl;
+    if (type == 1 && rdlen == 4) {
+      *ip = IPAddress(buf[pos], buf[pos + 1], buf[pos + 2], buf[pos + 3]);
+      *ttl = minTtl;
+      return true;
+    }
+    pos += rdlen; // CNAME or other record, keep walking
+  }
+  return false;
+}
+
+// ========== Query engine ==========
+
+static bool sendQuery(DnsEntry& e) {
+  if (!udpReady) {
+    udpReady = udp.begin(0) == 1; // any local port
+    if (!udpReady) return false;
+  }
+
+  IPAddress server = WiFi.dnsIP(0);
+  // Alternate servers on retries
+  if (e.pendingId != 0 && WiFi.dnsIP(1) != IPAddress(0, 0, 0, 0)) server = WiFi.dnsIP(1);
+
+  uint8_t packet[128];
+  // Unpredictable ids: the source port is fixed, so the id is all an
+  // off-path spoofer has to guess
+  uint16_t id;
+  do {
+    id = (uint16_t)esp_random();
+  } while (id == 0);
+  size_t len = buildQuery(id, e.host, packet, sizeof(packet));
+  if (len == 0) return false;
+
+  if (!udp.beginPacket(server, 53)) return false;
+  udp.write(packet, len);
+  if (!udp.endPacket()) return false;
+
+  e.pendingId = id;
+  e.server = server;
+  e.sentMillis = millis();
+  return true;
+}
+
+// Drain every reply waiting on the socket
+static void processReplies() {
+  if (!udpReady) return;
+  uint8_t packet[512];
+  while (udp.parsePacket() > 0) {
+    IPAddress from = udp.remoteIP();
+    uint16_t fromPort = udp.remotePort();
+    int len = udp.read(packet, sizeof(packet));
+    if (len < 12) continue;
+    uint16_t id = (packet[0] << 8) | packet[1];
+
+    for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+      DnsEntry& e = entries[i];
+      if (e.pendingId != id || e.host[0] == '\0') continue;
+      IPAddress ip;
+      uint32_t ttl;
+      // Only the server we asked, about the name we asked for
+      if (from != e.server || fromPort != 53 || !parseResponse(packet, len, e.host, &ip, &ttl)) {
+        stats.rejected++;
+        break;
+      }
+      bool wasRefresh = e.haveIp;
+      if (ttl < DNS_MIN_TTL_S) ttl = DNS_MIN_TTL_S;
+      if (ttl > DNS_MAX_TTL_S) ttl = DNS_MAX_TTL_S;
+      e.ip = ip;
+      e.haveIp = true;
+      e.ttlMs = ttl * 1000;
+      e.fetchedMillis = millis();
+      e.pendingId = 0;
+      if (wasRefresh) stats.refreshes++;
+      break;
+    }
+  }
+}
+
+static bool queryBlocking(DnsEntry& e, unsigned long start, uint32_t waitMs) {
+  for (uint8_t attempt = 0; attempt < 2 && timeLeft(start, waitMs) > 0; attempt++) {
+    if (!sendQuery(e)) continue;
+    unsigned long sent = millis();
+    uint32_t limit = min(DNS_QUERY_TIMEOUT_MS, timeLeft(start, waitMs));
+    while (millis() - sent < limit) {
+      processReplies();
+      if (e.pendingId == 0) return true;
+      delay(5);
+    }
+  }
+  e.pendingId = 0;
+  return false;
+}
+
+bool dnsCacheResolve(const char* host, IPAddress& ip, uint32_t waitMs) {
+  if (ip.fromString(host)) return true;
+  unsigned long start = millis();
+  // Another task may be mid-query: its wait counts against ours
+  CacheLock guard(pdMS_TO_TICKS(waitMs));
+  if (!guard.held) {
+    stats.failures++;
+    Serial.printf("[DNS] Resolver busy, no time left for %s\n", host);
+    return false;
+  }
+
+  DnsEntry* e = findEntry(host, true);
+  e->lastUsedMillis = millis();
+
+  if (entryFresh(*e)) {
+    stats.hits++;
+    ip = e->ip;
+    return true;
+  }
+
+  stats.misses++;
+  if (WiFi.status() == WL_CONNECTED && queryBlocking(*e, start, waitMs)) {
+    ip = e->ip;
+    return true;
+  }
+
+  if (e->haveIp) {
+    stats.staleServed++;
+    ip = e->ip;
+    // Back off: treat the stale address as fresh for a while instead of
+    // blocking every connect on a dead resolver
+    e->fetchedMillis = millis();
+    e->ttlMs = DNS_MIN_TTL_S * 1000;
+    Serial.printf("[DNS] Resolver unreachable, using last-known-good %s for %s\n", e->ip.toString().c_str(), host);
+    return true;
+  }
+
+  // Last resort: lwIP resolver (no TTL, cache for the minimum). It cannot
+  // be cut short, so only when its own timeout still fits
+  if (timeLeft(start, waitMs) >= DNS_LWIP_WAIT_MS && WiFi.hostByName(host, ip) == 1) {
+    e->ip = ip;
+    e->haveIp = true;
+    e->ttlMs = DNS_MIN_TTL_S * 1000;
+    e->fetchedMillis = millis();
+    return true;
+  }
+
+  stats.failures++;
+  Serial.printf("[DNS] Failed to resolve %s\n", host);
+  return false;
+}
+
+void dnsCacheLoop() {
+  if (WiFi.status() != WL_CONNECTED) return;
+  CacheLock guard;
+  processReplies();
+
+  for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    DnsEntry& e = entries[i];
+    if (e.host[0] == '\0' || !e.haveIp) continue;
+
+    if (e.pendingId != 0) {
+      // Lost reply: retry, on the secondary server when there is one
+      if (millis() - e.sentMillis > DNS_QUERY_TIMEOUT_MS) sendQuery(e);
+      continue;
+    }
+
+    unsigned long age = millis() - e.fetchedMillis;
+    // Only keep hosts warm that were used within their last TTL
+    bool inUse = millis() - e.lastUsedMillis < e.ttlMs + DNS_REFRESH_AHEAD_MS;
+    if (inUse && age + DNS_REFRESH_AHEAD_MS >= e.ttlMs) {
+      sendQuery(e);
+    }
+  }
+}
+
+const DnsCacheStats& dnsCacheStats() {
+  return stats;
+}
+
+// ========== DnsCachedClient ==========
+
+int DnsCachedClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  IPAddress ip;
+  unsigned long start = millis();
+  uint32_t waitMs = timeout > 0 ? (uint32_t)timeout : DNS_RESOLVE_WAIT_MS;
+  if (!dnsCacheResolve(host, ip, waitMs)) return 0;
+  uint32_t left = timeLeft(start, waitMs);
+  if (left == 0) return 0;
+  return WiFiClient::connect(ip, port, (int32_t)left);
+}
+
+int DnsCachedClient::connect(const char* host, uint16_t port) {
+  IPAddress ip;
+  if (!dnsCacheResolve(host, ip)) return 0;
+  return WiFiClient::connect(ip, port);
+}
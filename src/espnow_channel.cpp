@@ -0,0 +1,270 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "espnow_channel.h"
+#include "espnow_frames.h"
+
+static const uint32_t CHANNEL_POLL_MS = 1000;
+static const uint32_t REPLY_PEER_LINGER_MS = 100; // let the reply leave before deleting its peer
+
+struct Peer {
+  uint8_t mac[6];
+  bool used;
+};
+
+static Peer peers[ESPNOW_CHANNEL_MAX_PEERS];
+static uint8_t currentChannel = 0;
+static EspNowChannelStats stats = {};
+
+// Set from the Wi-Fi event task, applied from loop() or before a send
+static volatile uint8_t pendingChannel = 0;
+static unsigned long lastPollMillis = 0;
+
+// Between a channel change and the first delivered frame
+static volatile bool recovering = false;
+static unsigned long changeMillis = 0;
+
+// Discovery: probers to answer (WiFi task -> loop), one reply to wait for
+static QueueHandle_t probeQueue = nullptr;
+static volatile uint8_t discoveredChannel = 0;
+
+// Temporary peers used to answer probers that are not registered
+struct ReplyPeer {
+  uint8_t mac[6];
+  unsigned long addedMillis;
+  bool used;
+};
+static ReplyPeer replyPeers[ESPNOW_PROBE_QUEUE_DEPTH];
+
+static uint8_t radioChannel() {
+  uint8_t primary = 0;
+  wifi_second_chan_t second;
+  if (esp_wifi_get_channel(&primary, &second) != ESP_OK) return 0;
+  return primary;
+}
+
+// Re-register every known peer on a channel
+static void movePeers(uint8_t channel) {
+  for (uint8_t i = 0; i < ESPNOW_CHANNEL_MAX_PEERS; i++) {
+    if (!peers[i].used) continue;
+    esp_now_peer_info_t info;
+    if (esp_now_get_peer(peers[i].mac, &info) != ESP_OK) continue;
+    info.channel = channel;
+    if (esp_now_mod_peer(&info) == ESP_OK) stats.reregistrations++;
+  }
+  currentChannel = channel;
+  stats.channel = channel;
+}
+
+static void applyChannel(uint8_t channel) {
+  if (channel == 0 || channel == currentChannel) return;
+  Serial.printf("[ESP-NOW] Channel changed %u -> %u, re-registering peers\n", currentChannel, channel);
+  movePeers(channel);
+  stats.channelChanges++;
+  changeMillis = millis();
+  recovering = true;
+}
+
+static void syncChannel() {
+  uint8_t pending = pendingChannel;
+  if (pending) {
+    pendingChannel = 0;
+    applyChannel(pending);
+  }
+}
+
+// Wi-Fi event task: only record the new channel
+static void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+    pendingChannel = info.wifi_sta_connected.channel;
+  }
+}
+
+void espnowChannelBegin() {
+  if (probeQueue == nullptr) probeQueue = xQueueCreate(ESPNOW_PROBE_QUEUE_DEPTH, 6);
+  currentChannel = radioChannel();
+  stats.channel = currentChannel;
+  WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  Serial.printf("[ESP-NOW] Tracking Wi-Fi channel, now %u\n", currentChannel);
+}
+
+bool espnowChannelAddPeer(const uint8_t* mac) {
+  Peer* slot = nullptr;
+  for (uint8_t i = 0; i < ESPNOW_CHANNEL_MAX_PEERS; i++) {
+    if (peers[i].used && memcmp(peers[i].mac, mac, 6) == 0) {
+      slot = &peers[i];
+      break;
+    }
+    if (!peers[i].used && slot == nullptr) slot = &peers[i];
+  }
+  if (slot == nullptr) {
+    Serial.println("[ESP-NOW] Peer table full");
+    return false;
+  }
+
+  esp_now_peer_info_t info = {};
+  memcpy(info.peer_addr, mac, 6);
+  info.channel = currentChannel;
+  info.ifidx = WIFI_IF_STA;
+  info.encrypt = false;
+  esp_err_t err = esp_now_is_peer_exist(mac) ? esp_now_mod_peer(&info) : esp_now_add_peer(&info);
+  if (err != ESP_OK) return false;
+
+  memcpy(slot->mac, mac, 6);
+  slot->used = true;
+  return true;
+}
+
+esp_err_t espnowChannelSend(const uint8_t* mac, const uint8_t* data, size_t len) {
+  syncChannel();
+  esp_err_t result = esp_now_send(mac, data, len);
+  if (result != ESP_OK && recovering) stats.framesLost++;
+  return result;
+}
+
+static bool isPeer(const uint8_t* mac) {
+  for (uint8_t i = 0; i < ESPNOW_CHANNEL_MAX_PEERS; i++) {
+    if (peers[i].used && memcmp(peers[i].mac, mac, 6) == 0) return true;
+  }
+  return false;
+}
+
+void espnowChannelOnSent(const uint8_t* mac, esp_now_send_status_t status) {
+  if (!recovering || !isPeer(mac)) return;
+  if (status != ESP_NOW_SEND_SUCCESS) {
+    stats.framesLost++;
+    return;
+  }
+  recovering = false;
+  stats.lastRecoveryMs = millis() - changeMillis;
+  if (stats.lastRecoveryMs > stats.maxRecoveryMs) stats.maxRecoveryMs = stats.lastRecoveryMs;
+}
+
+bool espnowChannelOnRecv(const uint8_t* mac, const uint8_t* data, int len) {
+  if (len < (int)sizeof(EspNowFrameHeader)) return false;
+  switch (data[0]) {
+    case ESPNOW_FRAME_PROBE:
+      // Replying from the WiFi task is not allowed, loop() answers
+      if (probeQueue == nullptr || xQueueSend(probeQueue, mac, 0) != pdTRUE) stats.probesDropped++;
+      return true;
+    case ESPNOW_FRAME_CHANNEL:
+      if (len >= (int)(sizeof(EspNowFrameHeader) + sizeof(ChannelFrame))) {
+        discoveredChannel = data[sizeof(EspNowFrameHeader)];
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void sendDiscoveryFrame(const uint8_t* mac, EspNowFrameType type, uint8_t channel) {
+  uint8_t frame[sizeof(EspNowFrameHeader) + sizeof(ChannelFrame)];
+  EspNowFrameHeader header = {type, 0};
+  memcpy(frame, &header, sizeof(header));
+  size_t len = sizeof(header);
+  if (type == ESPNOW_FRAME_CHANNEL) frame[len++] = channel;
+  esp_now_send(mac, frame, len);
+}
+
+static void expireReplyPeers() {
+  for (uint8_t i = 0; i < ESPNOW_PROBE_QUEUE_DEPTH; i++) {
+    ReplyPeer& p = replyPeers[i];
+    if (p.used && millis() - p.addedMillis >= REPLY_PEER_LINGER_MS) {
+      esp_now_del_peer(p.mac);
+      p.used = false;
+    }
+  }
+}
+
+static bool addReplyPeer(const uint8_t* mac) {
+  ReplyPeer* slot = nullptr;
+  for (uint8_t i = 0; i < ESPNOW_PROBE_QUEUE_DEPTH && slot == nullptr; i++) {
+    if (!replyPeers[i].used) slot = &replyPeers[i];
+  }
+  if (slot == nullptr) return false;
+
+  esp_now_peer_info_t info = {};
+  memcpy(info.peer_addr, mac, 6);
+  info.channel = currentChannel;
+  info.ifidx = WIFI_IF_STA;
+  info.encrypt = false;
+  if (esp_now_add_peer(&info) != ESP_OK) return false;
+
+  memcpy(slot->mac, mac, 6);
+  slot->addedMillis = millis();
+  slot->used = true;
+  return true;
+}
+
+static void answerProbe(const uint8_t* mac) {
+  // Registered peers (ours or someone else's) are answered as they are
+  if (!esp_now_is_peer_exist(mac) && !addReplyPeer(mac)) {
+    Serial.println("[ESP-NOW] No room for a reply peer, probe not answered");
+    return;
+  }
+
+  // The prober switched to our channel to send this, so it can hear the reply
+  sendDiscoveryFrame(mac, ESPNOW_FRAME_CHANNEL, radioChannel());
+  stats.probesAnswered++;
+  Serial.printf("[ESP-NOW] Answered channel probe from %02X:%02X:%02X:%02X:%02X:%02X\n",
+                mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+void espnowChannelLoop() {
+  syncChannel();
+
+  // Fallback for channel switches that do not go through a reconnect
+  if (millis() - lastPollMillis >= CHANNEL_POLL_MS) {
+    lastPollMillis = millis();
+    if (WiFi.status() == WL_CONNECTED) applyChannel(radioChannel());
+  }
+
+  expireReplyPeers();
+
+  uint8_t mac[6];
+  while (probeQueue != nullptr && xQueueReceive(probeQueue, mac, 0) == pdTRUE) {
+    answerProbe(mac);
+  }
+}
+
+uint8_t espnowChannelDiscover(const uint8_t* mac, uint16_t dwellMs) {
+  if (WiFi.status() == WL_CONNECTED) {
+    applyChannel(radioChannel());
+    return currentChannel;
+  }
+  if (!espnowChannelAddPeer(mac)) return 0;
+
+  uint8_t original = radioChannel();
+  Serial.println("[ESP-NOW] Not associated, probing channels for the peer...");
+  for (uint8_t ch = 1; ch <= ESPNOW_CHANNEL_MAX; ch++) {
+    if (esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE) != ESP_OK) continue;
+    movePeers(ch);
+    discoveredChannel = 0;
+    sendDiscoveryFrame(mac, ESPNOW_FRAME_PROBE, 0);
+
+    unsigned long start = millis();
+    while (discoveredChannel == 0 && millis() - start < dwellMs) {
+      delay(5);
+    }
+    if (discoveredChannel == ch) {
+      stats.discoveries++;
+      Serial.printf("[ESP-NOW] Peer found on channel %u\n", ch);
+      return ch;
+    }
+  }
+
+  // Nobody answered: go back where we were
+  if (original) {
+    esp_wifi_set_channel(original, WIFI_SECOND_CHAN_NONE);
+    movePeers(original);
+  }
+  stats.discoveryFailures++;
+  Serial.println("[ESP-NOW] Peer did not answer on any channel");
+  return 0;
+}
+
+const EspNowChannelStats& espnowChannelStats() {
+  return stats;
+}
@@ -0,0 +1,223 @@
+#include <Arduino.h>
+#include <esp_now.h>
+#include "gateway.h"
+#include "espnow_frames.h"
+#include "espnow_channel.h"
+
+struct QueuedFrame {
+  uint8_t mac[6];
+  uint8_t len;
+  uint8_t data[ESP_NOW_MAX_DATA_LEN];
+};
+
+struct SenderState {
+  uint8_t mac[6];
+  SeqWindow window;
+  unsigned long lastSeenMillis;
+  bool used;
+};
+
+static QueueHandle_t frameQueue = nullptr;
+static SenderState senders[GATEWAY_MAX_SENDERS];
+static GatewayStats stats = {};
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+static unsigned long lastExpireMillis = 0;
+
+static uint8_t batch[GATEWAY_BATCH_BYTES];
+static size_t batchLen = 0;
+static unsigned long batchStartMillis = 0;
+static bool publishFailed = false;      // batch kept, retry after GATEWAY_PUBLISH_RETRY_MS
+static unsigned long publishFailedMillis = 0;
+
+bool seqWindowAccept(SeqWindow& window, uint16_t seq) {
+  if (!window.valid) {
+    window.highest = seq;
+    window.bitmap = 1;
+    window.valid = true;
+    return true;
+  }
+
+  int16_t diff = (int16_t)(seq - window.highest);
+  if (diff > 0) {
+    window.bitmap = diff >= 32 ? 1 : (window.bitmap << diff) | 1;
+    window.highest = seq;
+    return true;
+  }
+
+  uint16_t back = (uint16_t)(-diff);
+  if (back >= 32) return false; // older than the window
+  uint32_t bit = 1u << back;
+  if (window.bitmap & bit) return false;
+  window.bitmap |= bit;
+  return true;
+}
+
+// WiFi task context: copy and hand off, nothing else
+static void onDataRecv(const uint8_t* mac, const uint8_t* data, int len) {
+  if (espnowChannelOnRecv(mac, data, len)) return; // discovery, not station data
+  gatewayInject(mac, data, len);
+}
+
+// Counters are bumped from the WiFi task, the bench task and loop()
+#define STATS_ADD(field) do { portENTER_CRITICAL(&statsMux); stats.field++; portEXIT_CRITICAL(&statsMux); } while (0)
+
+bool gatewayInject(const uint8_t* mac, const uint8_t* data, int len) {
+  STATS_ADD(framesReceived);
+  if (len < (int)sizeof(EspNowFrameHeader) || len > ESP_NOW_MAX_DATA_LEN) {
+    STATS_ADD(malformed);
+    return false;
+  }
+
+  QueuedFrame frame;
+  memcpy(frame.mac, mac, 6);
+  frame.len = (uint8_t)len;
+  memcpy(frame.data, data, len);
+
+  if (xQueueSend(frameQueue, &frame, 0) != pdTRUE) {
+    STATS_ADD(queueDrops);
+    return false;
+  }
+  return true;
+}
+
+bool gatewayBegin() {
+  frameQueue = xQueueCreate(GATEWAY_QUEUE_DEPTH, sizeof(QueuedFrame));
+  if (frameQueue == nullptr) {
+    Serial.println("[GATEWAY] Failed to create frame queue");
+    return false;
+  }
+  if (esp_now_register_recv_cb(onDataRecv) != ESP_OK) {
+    Serial.println("[GATEWAY] Failed to register receive callback");
+    return false;
+  }
+  Serial.println("[GATEWAY] Listening for ESP-NOW frames");
+  return true;
+}
+
+static SenderState* findSender(const uint8_t* mac) {
+  SenderState* freeSlot = nullptr;
+  for (uint8_t i = 0; i < GATEWAY_MAX_SENDERS; i++) {
+    if (senders[i].used) {
+      if (memcmp(senders[i].mac, mac, 6) == 0) return &senders[i];
+    } else if (freeSlot == nullptr) {
+      freeSlot = &senders[i];
+    }
+  }
+  if (freeSlot) {
+    memcpy(freeSlot->mac, mac, 6);
+    freeSlot->window.valid = false;
+    freeSlot->lastSeenMillis = millis();
+    freeSlot->used = true;
+    portENTER_CRITICAL(&statsMux);
+    stats.activeSenders++;
+    portEXIT_CRITICAL(&statsMux);
+  }
+  return freeSlot;
+}
+
+// Stations that went away for good must not hold their slot forever
+static void expireSenders() {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < GATEWAY_MAX_SENDERS; i++) {
+    if (!senders[i].used || now - senders[i].lastSeenMillis < GATEWAY_SENDER_EVICT_MS) continue;
+    senders[i].used = false;
+    portENTER_CRITICAL(&statsMux);
+    stats.activeSenders--;
+    stats.sendersEvicted++;
+    portEXIT_CRITICAL(&statsMux);
+  }
+}
+
+// Returns false while the batch could not be published; it is kept as is
+static bool flushBatch(GatewayPublishFn publish) {
+  if (batchLen <= 1) return true;
+  // Broker down: don't hammer it on every loop
+  if (publishFailed && millis() - publishFailedMillis < GATEWAY_PUBLISH_RETRY_MS) return false;
+  if (!publish(batch, batchLen)) {
+    STATS_ADD(publishFailures);
+    publishFailed = true;
+    publishFailedMillis = millis();
+    return false;
+  }
+  portENTER_CRITICAL(&statsMux);
+  stats.publishes++;
+  stats.publishedBytes += batchLen;
+  portEXIT_CRITICAL(&statsMux);
+  publishFailed = false;
+  batchLen = 0;
+  return true;
+}
+
+static bool batchHasRoom(const QueuedFrame& frame) {
+  if (batchLen == 0) return true;
+  return batchLen + 6 + 1 + frame.len <= sizeof(batch) && batch[0] < 255;
+}
+
+// The caller made room with batchHasRoom() / flushBatch()
+static void appendToBatch(const QueuedFrame& frame, GatewayPublishFn publish) {
+  size_t recordLen = 6 + 1 + frame.len;
+  if (batchLen == 0) {
+    batch[0] = 0; // record count
+    batchLen = 1;
+    batchStartMillis = millis();
+  }
+  memcpy(batch + batchLen, frame.mac, 6);
+  batch[batchLen + 6] = frame.len;
+  memcpy(batch + batchLen + 7, frame.data, frame.len);
+  batchLen += recordLen;
+  batch[0]++;
+  if (batch[0] == 255) flushBatch(publish);
+}
+
+void gatewayLoop(GatewayPublishFn publish) {
+  if (millis() - lastExpireMillis >= 1000) {
+    lastExpireMillis = millis();
+    expireSenders();
+  }
+
+  QueuedFrame frame;
+  while (xQueuePeek(frameQueue, &frame, 0) == pdTRUE) {
+    // Batch full and unpublished: leave the frames queued. Once the queue
+    // overflows the radio callback counts them in queueDrops.
+    if (!batchHasRoom(frame) && !flushBatch(publish)) break;
+    xQueueReceive(frameQueue, &frame, 0);
+
+    SenderState* sender = findSender(frame.mac);
+    if (sender == nullptr) {
+      STATS_ADD(senderTableFull);
+      continue;
+    }
+
+    EspNowFrameHeader header;
+    memcpy(&header, frame.data, sizeof(header));
+
+    if (sender->window.valid && millis() - sender->lastSeenMillis > GATEWAY_SENDER_IDLE_RESET_MS) {
+      sender->window.valid = false; // probably rebooted, sequence restarted
+    }
+    // MAC retries are never this far back: the station rebooted within the
+    // idle timeout and restarted its sequence elsewhere
+    if (sender->window.valid && (int16_t)(sender->window.highest - header.seq) >= GATEWAY_SEQ_RESTART_GAP) {
+      sender->window.valid = false;
+      STATS_ADD(senderRestarts);
+    }
+    sender->lastSeenMillis = millis();
+    if (!seqWindowAccept(sender->window, header.seq)) {
+      STATS_ADD(duplicates);
+      continue;
+    }
+
+    STATS_ADD(framesAccepted);
+    appendToBatch(frame, publish);
+  }
+
+  if (batchLen > 1 && millis() - batchStartMillis >= GATEWAY_BATCH_MAX_AGE_MS) {
+    flushBatch(publish);
+  }
+}
+
+GatewayStats gatewayStats() {
+  portENTER_CRITICAL(&statsMux);
+  GatewayStats copy = stats;
+  portEXIT_CRITICAL(&statsMux);
+  return copy;
+}
@@ -0,0 +1,190 @@
+// Gateway role entry point (PlatformIO env "gateway", main.cpp is excluded).
+// Receives ESP-NOW frames from many stations and bridges them to MQTT over
+// a single broker connection. Build with -DGATEWAY_BENCH_SENDERS=N (env
+// "gateway_bench") to feed N simulated senders into the receive path.
+
+#include <Arduino.h>
+#include "secrets.h"
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <esp_now.h>
+#include <esp_random.h>
+#include "gateway.h"
+#include "espnow_frames.h"
+#include "espnow_channel.h"
+
+WiFiClient wifiClient;
+PubSubClient client(wifiClient);
+
+unsigned long lastStatsMillis = 0;
+const unsigned long statsIntervalMs = 10000;
+GatewayStats lastStats = {};
+
+// PubSubClient::connect() blocks: retry with capped exponential backoff so
+// the frame queue keeps draining while the broker is down
+const uint32_t mqttBackoffMinMs = 1000;
+const uint32_t mqttBackoffMaxMs = 30000;
+uint32_t mqttBackoffMs = mqttBackoffMinMs;
+unsigned long mqttNextAttemptMillis = 0;
+
+void connectToNetwork() {
+  Serial.println("[GATEWAY] Connecting to WiFi...");
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+
+  int attempts = 0;
+  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
+    delay(1000);
+    attempts++;
+    Serial.print(".");
+  }
+  Serial.println();
+
+  if (WiFi.status() == WL_CONNECTED) {
+    Serial.print("[GATEWAY] Connected, IP: ");
+    Serial.print(WiFi.localIP());
+    Serial.print(", channel ");
+    Serial.println(WiFi.channel());
+    Serial.print("[GATEWAY] MAC (set this as receiverMacAddress on stations): ");
+    Serial.println(WiFi.macAddress());
+  } else {
+    Serial.println("[GATEWAY] WiFi connection failed");
+  }
+}
+
+void mqttReconnect() {
+  if (client.connected()) return;
+  if ((long)(millis() - mqttNextAttemptMillis) < 0) return;
+
+  String clientId = "gw-" + String((uint32_t)ESP.getEfuseMac(), HEX);
+  Serial.print("[GATEWAY] MQTT connect as "); Serial.print(clientId); Serial.print("... ");
+  bool connected = MQTT_USER[0] != '\0'
+                     ? client.connect(clientId.c_str(), MQTT_USER, MQTT_PASSWORD)
+                     : client.connect(clientId.c_str());
+  Serial.println(connected ? "connected" : "failed");
+
+  if (connected) {
+    mqttBackoffMs = mqttBackoffMinMs;
+    return;
+  }
+  // Jitter so a fleet of gateways does not retry in lockstep
+  uint32_t delayMs = mqttBackoffMs / 2 + esp_random() % (mqttBackoffMs / 2 + 1);
+  mqttNextAttemptMillis = millis() + delayMs;
+  mqttBackoffMs = mqttBackoffMs * 2 > mqttBackoffMaxMs ? mqttBackoffMaxMs : mqttBackoffMs * 2;
+  Serial.printf("[GATEWAY] Next MQTT attempt in %lu ms\n", (unsigned long)delayMs);
+}
+
+bool publishBatch(const uint8_t* payload, size_t len) {
+  if (!client.connected()) return false;
+  return client.publish(MQTT_TOPIC_GATEWAY, payload, len);
+}
+
+void printStats() {
+  GatewayStats s = gatewayStats();
+  float seconds = statsIntervalMs / 1000.0;
+
+  Serial.println("\n========== GATEWAY STATS ==========");
+  Serial.printf("Senders: %u/%u, %lu evicted, %lu restarts, broker connections: 1\n", s.activeSenders, GATEWAY_MAX_SENDERS,
+                (unsigned long)s.sendersEvicted, (unsigned long)s.senderRestarts);
+  Serial.printf("Frames: %lu rx, %lu accepted, %lu dup, %lu queue drops, %lu malformed\n",
+                (unsigned long)s.framesReceived, (unsigned long)s.framesAccepted,
+                (unsigned long)s.duplicates, (unsigned long)s.queueDrops, (unsigned long)s.malformed);
+  // Any of these is traffic the throughput figures above do not include
+  Serial.printf("Dropped: %lu sender table full\n", (unsigned long)s.senderTableFull);
+  Serial.printf("Throughput: %.1f frames/s in, %.1f publishes/s, %.1f bytes/s out\n",
+                (s.framesAccepted - lastStats.framesAccepted) / seconds,
+                (s.publishes - lastStats.publishes) / seconds,
+                (s.publishedBytes - lastStats.publishedBytes) / seconds);
+  Serial.printf("Publishes: %lu ok, %lu failed\n", (unsigned long)s.publishes, (unsigned long)s.publishFailures);
+  const EspNowChannelStats& c = espnowChannelStats();
+  Serial.printf("Channel: %u, %lu changes, %lu probes answered\n",
+                c.channel, (unsigned long)c.channelChanges, (unsigned long)c.probesAnswered);
+  Serial.println("===================================\n");
+
+  lastStats = s;
+}
+
+#ifdef GATEWAY_BENCH_SENDERS
+static_assert(GATEWAY_BENCH_SENDERS <= GATEWAY_MAX_SENDERS, "bench senders would overflow the sender table");
+
+#ifndef GATEWAY_BENCH_FPS
+#define GATEWAY_BENCH_FPS 500 // total frames per second across all senders
+#endif
+
+// Simulated stations: locally administered MACs 02:00:00:00:00:xx, each
+// sending coord frames with its own sequence; every 20th frame is repeated
+// to exercise deduplication.
+void benchTask(void*) {
+  uint16_t seq[GATEWAY_BENCH_SENDERS] = {0};
+  uint8_t frame[sizeof(EspNowFrameHeader) + 8];
+  uint32_t sent = 0;
+  TickType_t lastWake = xTaskGetTickCount();
+  // Above the tick rate send several frames per tick, below it wait several ticks
+  const uint32_t framesPerWake = GATEWAY_BENCH_FPS >= configTICK_RATE_HZ ? GATEWAY_BENCH_FPS / configTICK_RATE_HZ : 1;
+  const TickType_t ticksPerWake = GATEWAY_BENCH_FPS >= configTICK_RATE_HZ ? 1 : configTICK_RATE_HZ / GATEWAY_BENCH_FPS;
+
+  while (true) {
+    for (uint32_t i = 0; i < framesPerWake; i++) {
+      uint8_t sender = sent % GATEWAY_BENCH_SENDERS;
+      uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, sender};
+      EspNowFrameHeader header = {ESPNOW_FRAME_COORD, seq[sender]};
+      memcpy(frame, &header, sizeof(header));
+      memset(frame + sizeof(header), sender, sizeof(frame) - sizeof(header));
+
+      gatewayInject(mac, frame, sizeof(frame));
+      if (seq[sender] % 20 == 0) {
+        gatewayInject(mac, frame, sizeof(frame)); // duplicate
+      }
+      seq[sender]++;
+      sent++;
+    }
+    vTaskDelayUntil(&lastWake, ticksPerWake);
+  }
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+  while(!Serial);
+
+  connectToNetwork();
+
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("[GATEWAY] Error initializing ESP-NOW");
+    return;
+  }
+  gatewayBegin();
+  // Answer station probes with our channel, follow AP channel changes
+  espnowChannelBegin();
+
+  client.setServer(MQTT_SERVER, MQTT_PORT);
+  client.setBufferSize(GATEWAY_BATCH_BYTES + 64);
+
+#ifdef GATEWAY_BENCH_SENDERS
+  Serial.printf("[GATEWAY] Benchmark: %d simulated senders, %d frames/s\n", GATEWAY_BENCH_SENDERS, GATEWAY_BENCH_FPS);
+  xTaskCreate(benchTask, "gw_bench", 4096, nullptr, 1, nullptr);
+#endif
+}
+
+void loop() {
+  if (WiFi.status() != WL_CONNECTED) {
+    connectToNetwork();
+    delay(1000);
+    return;
+  }
+
+  if (!client.connected()) {
+    mqttReconnect();
+  }
+  client.loop();
+
+  espnowChannelLoop();
+  gatewayLoop(publishBatch);
+
+  if (millis() - lastStatsMillis >= statsIntervalMs) {
+    lastStatsMillis = millis();
+    printStats();
+  }
+
+  delay(1);
+}
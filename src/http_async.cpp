@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/queue.h>
+#include "http_async.h"
+#include "transport_pool.h"
+
+static QueueHandle_t requestQueue = nullptr;
+static HttpAsyncStats stats = {};
+
+// Time left before the batch deadline, capped at limitMs
+static uint32_t remainingMs(const HttpAsyncRequest& r, uint32_t limitMs) {
+  long left = (long)(r.deadlineMillis - millis());
+  if (left <= 0) return 0;
+  return (uint32_t)left < limitMs ? (uint32_t)left : limitMs;
+}
+
+// Same, for socket timeouts, where 0 would mean no timeout at all
+static uint32_t timeoutMs(const HttpAsyncRequest& r, uint32_t limitMs) {
+  uint32_t ms = remainingMs(r, limitMs);
+  return ms ? ms : 1;
+}
+
+static void execute(HttpAsyncRequest& r) {
+  if (WiFi.status() != WL_CONNECTED) {
+    r.status = HTTPC_ERROR_NOT_CONNECTED;
+    return;
+  }
+  if (remainingMs(r, 1) == 0) {
+    r.status = HTTPC_ERROR_READ_TIMEOUT; // waited in the queue past the deadline
+    return;
+  }
+
+  // Checked out for this request only: concurrent requests never share a socket
+  WiFiClient* transport = transportAcquire(r.url, remainingMs(r, HTTP_ASYNC_ACQUIRE_MS));
+  if (transport == nullptr) {
+    r.status = HTTPC_ERROR_CONNECTION_REFUSED;
+    return;
+  }
+
+  HTTPClient http;
+  http.setConnectTimeout(timeoutMs(r, HTTP_ASYNC_CONNECT_MS));
+  http.setTimeout(timeoutMs(r, HTTP_ASYNC_TIMEOUT_MS));
+  http.setReuse(true);
+  if (!http.begin(*transport, r.url)) {
+    r.status = HTTPC_ERROR_CONNECTION_REFUSED;
+    transportRelease(transport);
+    return;
+  }
+
+  if (r.authToken != nullptr) {
+    String authHeader = "Bearer ";
+    authHeader += r.authToken;
+    http.addHeader("Authorization", authHeader);
+  }
+  if (r.body != nullptr) {
+    http.addHeader("Content-Type", r.contentType ? r.contentType : "application/json");
+  }
+  if (r.onPrepare) r.onPrepare(r, http);
+
+  r.status = http.sendRequest(r.method, (uint8_t*)r.body, r.body ? strlen(r.body) : 0);
+  if (r.status > 0 && remainingMs(r, 1) == 0) {
+    r.status = HTTPC_ERROR_READ_TIMEOUT; // no time left for the body
+    http.setReuse(false);
+  }
+  // The connect used part of the budget: the body gets what is left
+  if (r.status > 0) http.setTimeout(timeoutMs(r, HTTP_ASYNC_TIMEOUT_MS));
+  if (r.status > 0) {
+    if (r.onResponse) r.onResponse(r, http);
+    r.response = http.getString();
+  }
+
+  http.end();
+  transportRelease(transport);
+}
+
+static void workerTask(void*) {
+  for (;;) {
+    HttpAsyncRequest* r;
+    if (xQueueReceive(requestQueue, &r, portMAX_DELAY) != pdTRUE) continue;
+
+    unsigned long start = millis();
+    execute(*r);
+    r->elapsedMs = millis() - start;
+
+    // The caller may reuse the request as soon as done is set
+    TaskHandle_t waiter = r->waiter;
+    r->done = true;
+    xTaskNotifyGive(waiter);
+  }
+}
+
+bool httpAsyncBegin() {
+  if (requestQueue != nullptr) return true;
+  requestQueue = xQueueCreate(HTTP_ASYNC_QUEUE_DEPTH, sizeof(HttpAsyncRequest*));
+  if (requestQueue == nullptr) {
+    Serial.println("[HTTP] Failed to create request queue");
+    return false;
+  }
+  for (uint8_t i = 0; i < HTTP_ASYNC_WORKERS; i++) {
+    char name[12];
+    snprintf(name, sizeof(name), "http%u", i);
+    // 8 KB: HTTPClient plus a TLS handshake for https:// URLs
+    if (xTaskCreatePinnedToCore(workerTask, name, 8192, nullptr, 1, nullptr, tskNO_AFFINITY) != pdPASS) {
+      Serial.printf("[HTTP] Failed to start worker %u\n", i);
+      return i > 0;
+    }
+  }
+  return true;
+}
+
+size_t httpAsyncRunAll(HttpAsyncRequest* requests, size_t count) {
+  if (count == 0 || !httpAsyncBegin()) return 0;
+
+  unsigned long start = millis();
+  unsigned long deadline = start + HTTP_ASYNC_BATCH_MS;
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  for (size_t i = 0; i < count; i++) {
+    HttpAsyncRequest& r = requests[i];
+    r.status = 0;
+    r.response = "";
+    r.elapsedMs = 0;
+    r.done = false;
+    r.waiter = self;
+    r.deadlineMillis = deadline;
+    HttpAsyncRequest* p = &r;
+    // Blocks while the queue is full: a batch larger than the queue still runs
+    if (xQueueSend(requestQueue, &p, pdMS_TO_TICKS(remainingMs(r, HTTP_ASYNC_BATCH_MS))) != pdTRUE) {
+      r.status = HTTPC_ERROR_READ_TIMEOUT;
+      r.done = true;
+    }
+  }
+
+  // Worker timeouts are clamped to the deadline, so this ends around it; the
+  // requests are still referenced by the workers until done, so never leave early
+  for (;;) {
+    bool allDone = true;
+    for (size_t i = 0; i < count; i++) {
+      if (!requests[i].done) allDone = false;
+    }
+    if (allDone) break;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+  }
+
+  size_t ok = 0;
+  uint32_t sumMs = 0;
+  for (size_t i = 0; i < count; i++) {
+    sumMs += requests[i].elapsedMs;
+    if (requests[i].status > 0) ok++;
+    else stats.failures++;
+    if (requests[i].status == HTTPC_ERROR_READ_TIMEOUT && (long)(millis() - deadline) >= 0) stats.deadlineMisses++;
+  }
+  stats.requests += count;
+  stats.batches++;
+  stats.lastBatchMs = millis() - start;
+  stats.lastBatchSumMs = sumMs;
+  return ok;
+}
+
+const HttpAsyncStats& httpAsyncStats() {
+  return stats;
+}
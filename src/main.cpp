@@ -1,10 +1,24 @@
 #include <Arduino.h>
 #include "secrets.h"
 #include <WiFi.h>
-#include <PubSubClient.h>
 #include <HTTPClient.h>
 #include <esp_now.h>
 #include <esp_wifi.h>
+#include <esp_random.h>
+#include "coord_codec.h"
+#include "rest_poller.h"
+#include "ranger.h"
+#include "espnow_frames.h"
+#include "espnow_channel.h"
+#include "command_dispatcher.h"
+#include "clock_sync.h"
+#include "tls_transport.h"
+#include "dns_cache.h"
+#include "stall_monitor.h"
+#include "sample_log.h"
+#include "mqtt_async.h"
+#include "power_governor.h"
+#include "http_async.h"
 
 const char *ssid = WIFI_SSID;
 const char *password = WIFI_PASSWORD;
@@ -14,18 +28,33 @@ const char *password = WIFI_PASSWORD;
 uint8_t receiverMacAddress[] = {0xCC, 0xBA, 0x97, 0x16, 0x2A, 0xF8}; // Broadcast address - change to specific MAC
 
 // ESP-NOW variables
-esp_now_peer_info_t peerInfo;
 bool espNowInitialized = false;
+uint16_t espnowFrameSeq = 0; // link sequence, lets the gateway drop duplicates
 
 
 // Use values from secrets.h so they can be configured centrally
 const char *mqtt_server = MQTT_SERVER;  // Your broker hostname (from secrets.h)
 const int mqtt_port = MQTT_PORT;
 
-WiFiClient wifiClient;
-PubSubClient client(wifiClient);
-void mqttReconnect() ;
+#if MQTT_USE_TLS
+TlsTransport wifiClient; // resumes the TLS session on MQTT reconnects
+#else
+DnsCachedClient wifiClient; // broker hostname resolved through the shared DNS cache
+#endif
+MqttAsyncClient client(wifiClient); // network I/O on its own task
+void reportMqttState() ;
 void publishCoordinates(const struct ISSData& data);
+void appendHistorySample(const struct ISSData& data);
+void publishRangeStats(const struct RangeStats& stats);
+void checkDataFreshness();
+void publishTlsStats();
+void publishMqttStats();
+void publishEspNowStats();
+void publishPowerStats();
+void publishStallReport();
+void startHistoryQuery(const byte* payload, unsigned int length);
+void serviceHistoryQuery();
+void holdBurstForMqtt(bool burstActive);
 // Structure to store ISS position data
 struct ISSData {
   String message;        // API response status
@@ -33,26 +62,158 @@ struct ISSData {
   float longitude;       // ISS longitude
   unsigned long timestamp; // Unix timestamp
   bool dataValid;        // Whether we have valid data
+  uint64_t receivedUtcMs; // Local SNTP time when the API response arrived (0 = clock not synced)
 };
 
 // Global variable to store the latest ISS data
-ISSData issData = {"", 0.0, 0.0, 0, false};
+ISSData issData = {"", 0.0, 0.0, 0, false, 0};
+
+// Pipeline delays for one sample, derived at send time
+struct SampleTiming {
+  uint64_t sendUtcMs;  // now, 0 if the clock is not synced
+  uint32_t rxDelayMs;  // API capture -> local receive
+  uint32_t txDelayMs;  // local receive -> send
+};
+
+SampleTiming sampleTiming(const ISSData& data) {
+  SampleTiming t = {clockNowUtcMs(), 0, 0};
+  if (t.sendUtcMs == 0 || data.receivedUtcMs == 0) return t;
+  uint64_t captureUtcMs = (uint64_t)data.timestamp * 1000;
+  if (data.receivedUtcMs > captureUtcMs) t.rxDelayMs = (uint32_t)(data.receivedUtcMs - captureUtcMs);
+  if (t.sendUtcMs > data.receivedUtcMs) t.txDelayMs = (uint32_t)(t.sendUtcMs - data.receivedUtcMs);
+  return t;
+}
+
+// Periodic TLS handshake statistics on MQTT_TOPIC_STATUS
+unsigned long lastTlsStatsMillis = 0;
+const unsigned long tlsStatsIntervalMs = 60000;
+
+// Alert on MQTT_TOPIC_STATUS when the latest sample is older than this
+uint32_t staleThresholdMs = 30000;
+bool staleAlerted = false;
 
 // Timing for periodic ISS API polling
-unsigned long lastFetchMillis = 0;
 const unsigned long fetchIntervalMs = 10000; // fetch every 10s
 
+// ========== REST endpoint schemas ==========
+
+// Typed records filled by restExtract() (see rest_poller.h)
+struct IssNowRecord {
+  char message[16];
+  float latitude;
+  float longitude;
+  unsigned long timestamp;
+};
+
+struct AstrosRecord {
+  char message[16];
+  int number; // people currently in space
+};
+
+static constexpr RestField issNowFields[] = {
+  REST_FIELD(IssNowRecord, message, "message"),
+  REST_FIELD(IssNowRecord, latitude, "iss_position.latitude"),
+  REST_FIELD(IssNowRecord, longitude, "iss_position.longitude"),
+  REST_FIELD(IssNowRecord, timestamp, "timestamp"),
+};
+REST_SCHEMA_CHECK(issNowFields);
+
+static constexpr RestField astrosFields[] = {
+  REST_FIELD(AstrosRecord, message, "message"),
+  REST_FIELD(AstrosRecord, number, "number"),
+};
+REST_SCHEMA_CHECK(astrosFields);
+
+IssNowRecord issNowRecord;
+AstrosRecord astrosRecord;
+
+void onIssNowRecord(RestEndpoint& endpoint, uint32_t foundMask);
+void onAstrosRecord(RestEndpoint& endpoint, uint32_t foundMask);
+
+// Indexes into restEndpoints[]
+enum { REST_ISS_NOW = 0, REST_ASTROS = 1 };
+
+RestEndpoint restEndpoints[] = {
+  REST_ENDPOINT("iss-now", "http://api.open-notify.org/iss-now.json", fetchIntervalMs, issNowFields, issNowRecord, onIssNowRecord),
+  REST_ENDPOINT("astros", "http://api.open-notify.org/astros.json", 600000, astrosFields, astrosRecord, onAstrosRecord),
+};
+const size_t restEndpointCount = sizeof(restEndpoints) / sizeof(restEndpoints[0]);
+
 // Track last published ISS timestamp so we only publish when data changes
 unsigned long lastPublishedTimestamp = 0;
 
+// Range query over the flash sample log, answered one chunk per loop()
+SampleLogCursor historyQuery = {0, 0, 0, 0, true};
+uint32_t historyQueryFrom = 0;
+uint32_t historyQueryTo = 0;
+uint32_t historyQuerySamples = 0;
+uint32_t historyQueryChunks = 0;
+bool historyQueryReported = true;
+unsigned long historyQueryBlockedMillis = 0; // first refused chunk, 0 = not blocked
+const unsigned long historyQueryTimeoutMs = 30000;
+
 // Timing for ESP-NOW sends
 unsigned long lastESPNowSendMillis = 0;
-const unsigned long espnowSendIntervalMs = 2000; // send every 2 seconds
+uint32_t espnowSendIntervalMs = 2000; // send every 2 seconds (tunable over MQTT)
+uint32_t espnowDiscover = 1; // probe channels for the receiver when booting without Wi-Fi
+
+// Delta/varint coordinate streams (see coord_codec.h)
+// ESP-NOW is lossy, so resync with a keyframe more often than on MQTT
+CoordStreamEncoder espnowEncoder(8);
+CoordStreamEncoder historyEncoder(32);
+const uint8_t historyBatchMax = 32;
+uint32_t historyBatchSamples = 16; // samples per MQTT history publish (tunable over MQTT)
+uint8_t historyBatch[historyBatchMax * COORD_CODEC_MAX_FRAME];
+size_t historyBatchLen = 0;
+uint8_t historyBatchCount = 0;
+
+// Log verbosity (tunable over MQTT): 0 = errors, 1 = info, 2 = debug
+enum { LOG_ERROR = 0, LOG_INFO = 1, LOG_DEBUG = 2 };
+uint32_t logLevel = LOG_INFO;
+
+// QoS 1 messages awaiting PUBACK at once (tunable over MQTT)
+uint32_t mqttInflightWindow = 4;
+
+void applyMqttWindow(const CommandParam& param) {
+  client.setInflightWindow((uint8_t)*param.value);
+}
+
+// Idle at the minimum clock with DTIM modem sleep between bursts (tunable over MQTT)
+uint32_t powerSave = 1;
+
+void applyPowerSave(const CommandParam& param) {
+  powerGovernorEnable(*param.value != 0);
+}
+
+// publish() only queues: a burst stays open until the MQTT task has written
+// the messages and the PUBACKs are back, or for mqttBurstMaxMs at most
+bool mqttBurstHeld = false;
+unsigned long mqttBurstSinceMillis = 0;
+const unsigned long mqttBurstMaxMs = 3000;
+
+// Parameters reachable at MQTT_TOPIC_CMD/<name>, persisted to NVS
+CommandParam commandParams[] = {
+  {"fetch_ms", &restEndpoints[REST_ISS_NOW].periodMs, 2000, 3600000, nullptr},
+  {"astros_ms", &restEndpoints[REST_ASTROS].periodMs, 60000, 86400000, nullptr},
+  {"espnow_ms", &espnowSendIntervalMs, 500, 600000, nullptr},
+  {"espnow_discover", &espnowDiscover, 0, 1, nullptr},
+  {"log_level", &logLevel, LOG_ERROR, LOG_DEBUG, nullptr},
+  {"history_batch", &historyBatchSamples, 1, historyBatchMax, nullptr},
+  {"stale_ms", &staleThresholdMs, 5000, 3600000, nullptr},
+  {"mqtt_window", &mqttInflightWindow, 1, MQTT_ASYNC_MAX_INFLIGHT, applyMqttWindow},
+  {"power_save", &powerSave, 0, 1, applyPowerSave},
+};
+const uint8_t commandParamCount = sizeof(commandParams) / sizeof(commandParams[0]);
 
 // ========== ESP-NOW Functions ==========
 
 // Callback when data is sent via ESP-NOW
 void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
+  espnowChannelOnSent(mac_addr, status);
+  if (logLevel < LOG_DEBUG) {
+    if (status != ESP_NOW_SEND_SUCCESS) Serial.println("[ESP-NOW] Send FAILED - Data not delivered!");
+    return;
+  }
   Serial.println("\n========== ESP-NOW CALLBACK ==========");
   Serial.print("[ESP-NOW] Packet sent to: ");
   for (int i = 0; i < 6; i++) {
@@ -70,6 +231,11 @@ void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
   Serial.println("======================================\n");
 }
 
+// Callback when data is received via ESP-NOW (only discovery frames for a station)
+void OnDataRecv(const uint8_t *mac_addr, const uint8_t *data, int len) {
+  espnowChannelOnRecv(mac_addr, data, len);
+}
+
 // Initialize ESP-NOW
 bool initESPNow() {
   // Init ESP-NOW
@@ -79,29 +245,27 @@ bool initESPNow() {
   }
   
   Serial.println("[ESP-NOW] Successfully initialized");
+
+  // Random start: after a reboot the gateway sees a jump, not a replay of
+  // the sequence numbers it already accepted
+  espnowFrameSeq = (uint16_t)esp_random();
   
-  // Register send callback
+  // Register send and receive callbacks
   esp_now_register_send_cb(OnDataSent);
-  
-  // Get the current WiFi channel
-  uint8_t currentChannel = WiFi.channel();
-  Serial.print("[ESP-NOW] Current WiFi Channel: ");
-  Serial.println(currentChannel);
-  
-  // Register peer
-  memcpy(peerInfo.peer_addr, receiverMacAddress, 6);
-  peerInfo.channel = currentChannel;  // Use actual WiFi channel
-  peerInfo.encrypt = false;
-  
-  // Add peer
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+  esp_now_register_recv_cb(OnDataRecv);
+
+  // Peers follow the Wi-Fi channel from now on (roams, AP channel changes)
+  espnowChannelBegin();
+
+  // Add peer on the current WiFi channel
+  if (!espnowChannelAddPeer(receiverMacAddress)) {
     Serial.println("[ESP-NOW] Failed to add peer");
     return false;
   }
   
   Serial.println("[ESP-NOW] Peer added successfully");
   Serial.print("[ESP-NOW] Peer channel set to: ");
-  Serial.println(peerInfo.channel);
+  Serial.println(espnowChannelStats().channel);
   Serial.print("[ESP-NOW] Receiver MAC: ");
   for (int i = 0; i < 6; i++) {
     Serial.printf("%02X", receiverMacAddress[i]);
@@ -112,80 +276,60 @@ bool initESPNow() {
   return true;
 }
 
-// Send JSON data via ESP-NOW
-void sendJsonViaESPNow(String jsonData) {
+// Send one binary frame via ESP-NOW behind an EspNowFrameHeader (espnow_frames.h)
+void sendFrameViaESPNow(EspNowFrameType type, const uint8_t* body, size_t len) {
   if (!espNowInitialized) {
     Serial.println("[ESP-NOW] ESP-NOW not initialized, skipping send");
     return;
   }
-  
-  // Check WiFi status
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("[ESP-NOW] WARNING: WiFi not connected!");
-  }
-  
-  // Verify we're on the right channel
-  Serial.print("[ESP-NOW] Current WiFi channel: ");
-  Serial.println(WiFi.channel());
-  
-  // ESP-NOW has a limit of 250 bytes per packet
-  if (jsonData.length() > 250) {
-    Serial.println("[ESP-NOW] Warning: JSON data exceeds 250 bytes, truncating...");
-    jsonData = jsonData.substring(0, 250);
+
+  uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+  if (len + sizeof(EspNowFrameHeader) > sizeof(frame)) {
+    Serial.println("[ESP-NOW] Frame too large, dropping");
+    return;
   }
-  
-  Serial.println("\n[ESP-NOW] Sending JSON data...");
-  Serial.print("[ESP-NOW] Data length: ");
-  Serial.print(jsonData.length());
+  EspNowFrameHeader header = {type, espnowFrameSeq++};
+  memcpy(frame, &header, sizeof(header));
+  memcpy(frame + sizeof(header), body, len);
+  size_t frameLen = len + sizeof(header);
+
+  Serial.print("[ESP-NOW] Sending frame '");
+  Serial.print((char)type);
+  Serial.print("' seq ");
+  Serial.print(header.seq);
+  Serial.print(": ");
+  Serial.print(frameLen);
   Serial.println(" bytes");
-  Serial.print("[ESP-NOW] Target MAC: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", receiverMacAddress[i]);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
-  Serial.print("[ESP-NOW] Data: ");
-  Serial.println(jsonData);
-  Serial.flush(); // Ensure all data is sent to serial before ESP-NOW send
-  
-  // Send data
-  esp_err_t result = esp_now_send(receiverMacAddress, (uint8_t *)jsonData.c_str(), jsonData.length());
-  
-  if (result == ESP_OK) {
-    Serial.println("[ESP-NOW] Data sent successfully (queued)");
-    Serial.println("[ESP-NOW] Waiting for send callback...");
-    Serial.flush(); // Flush before delay
-    delay(250); // Give callback time to execute and display
-  } else {
-    Serial.println("[ESP-NOW] Error sending data");
-    Serial.print("[ESP-NOW] Error code: ");
+
+  esp_err_t result = espnowChannelSend(receiverMacAddress, frame, frameLen);
+  if (result != ESP_OK) {
+    Serial.print("[ESP-NOW] Error sending frame, code: ");
     Serial.println(result);
-    
-    // Detailed error descriptions
-    if (result == ESP_ERR_ESPNOW_NOT_INIT) {
-      Serial.println("[ESP-NOW] ESP-NOW not initialized");
-    } else if (result == ESP_ERR_ESPNOW_ARG) {
-      Serial.println("[ESP-NOW] Invalid argument");
-    } else if (result == ESP_ERR_ESPNOW_INTERNAL) {
-      Serial.println("[ESP-NOW] Internal error");
-    } else if (result == ESP_ERR_ESPNOW_NO_MEM) {
-      Serial.println("[ESP-NOW] Out of memory");
-    } else if (result == ESP_ERR_ESPNOW_NOT_FOUND) {
-      Serial.println("[ESP-NOW] Peer not found");
-    }
   }
-  Serial.flush(); // Final flush
 }
 
 // ========== End ESP-NOW Functions ==========
 
 void callback(char* topic, byte* payload, unsigned int length) {
   Serial.print("Topic: "); Serial.println(topic);
-  String msg;
-  for (unsigned int i = 0; i < length; i++) {
-    msg += (char)payload[i];
+
+  if (strcmp(topic, MQTT_TOPIC_HISTORY_QUERY) == 0) {
+    startHistoryQuery(payload, length);
+    return;
   }
-  Serial.print("Payload: "); Serial.println(msg);
+
+  // Payload is parsed in place from the MQTT pool buffer
+  CommandResult result = commandDispatch(topic, payload, length);
+  if (result.status == COMMAND_NOT_MINE) return;
+
+  // Only our own names go into the JSON, never the broker-supplied topic
+  char ack[128];
+  snprintf(ack, sizeof(ack), "{\"param\":\"%s\",\"value\":%lu,\"status\":\"%s\"}",
+           result.param ? result.param->name : (result.status == COMMAND_OK ? "reset" : "unknown"),
+           result.param ? (unsigned long)*result.param->value : 0UL,
+           commandStatusToString(result.status));
+  Serial.print("[CMD] "); Serial.println(ack);
+  client.publish(MQTT_TOPIC_STATUS, ack);
 }
 
 /*void mqttCallback(char* topic, byte* payload, unsigned int length) {
@@ -463,20 +607,24 @@ void parseAndDisplayJson(String json) {
   Serial.println("=====================================\n");
 }
 
+/* Copy an extracted iss-now record into the global structure */
+void storeISSRecord(const IssNowRecord& record, uint32_t foundMask) {
+  const uint32_t allFields = (1u << REST_SCHEMA_COUNT(issNowFields)) - 1;
+
+  issData.message = record.message;
+  issData.latitude = record.latitude;
+  issData.longitude = record.longitude;
+  issData.timestamp = record.timestamp;
+  issData.dataValid = (foundMask == allFields) && (strcmp(record.message, "success") == 0);
+  issData.receivedUtcMs = clockNowUtcMs();
+}
+
 /* Function to extract and store ISS data from JSON response */
 void extractAndStoreISSData(String json) {
-  // Extract the values
-  String message = extractJsonValue(json, "message");
-  String latStr = extractJsonValue(json, "latitude");
-  String lonStr = extractJsonValue(json, "longitude");
-  String timestampStr = extractJsonValue(json, "timestamp");
-  
-  // Store in global structure
-  issData.message = message;
-  issData.latitude = latStr.toFloat();
-  issData.longitude = lonStr.toFloat();
-  issData.timestamp = timestampStr.toInt();
-  issData.dataValid = (message == "success");
+  // Single schema-driven pass instead of one search per key
+  memset(&issNowRecord, 0, sizeof(issNowRecord));
+  uint32_t found = restExtract(json.c_str(), json.length(), issNowFields, REST_SCHEMA_COUNT(issNowFields), &issNowRecord);
+  storeISSRecord(issNowRecord, found);
   
   // Print confirmation
   Serial.println("\n>>> Data stored in 'issData' structure:");
@@ -496,14 +644,13 @@ void extractAndStoreISSData(String json) {
 /* Example: Get specific values from JSON response */
 void getSpecificData(const char* url, String key1, String key2 = "", String key3 = "") {
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    
     Serial.println("\n--- Getting Specific Data ---");
-    http.begin(url);
-    int httpResponseCode = http.GET();
+    HttpAsyncRequest request = {"GET", url};
+    httpAsyncRun(request);
+    int httpResponseCode = request.status;
     
     if (httpResponseCode == 200) {
-      String payload = http.getString();
+      const String& payload = request.response;
       
       // Extract and display specific values
       if (key1 != "") {
@@ -531,38 +678,32 @@ void getSpecificData(const char* url, String key1, String key2 = "", String key3
       Serial.print("Error: ");
       Serial.println(httpResponseCode);
     }
-    
-    http.end();
   }
 }
 
 /* Function to send HTTP GET request */
 void sendHTTPGet(const char* url) {
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    
     Serial.println("\n--- HTTP GET Request ---");
     Serial.print("URL: ");
     Serial.println(url);
     
-    http.begin(url);  // Specify the URL
-    
-    int httpResponseCode = http.GET();  // Send the request
+    // Send the request over a pooled connection
+    HttpAsyncRequest request = {"GET", url};
+    httpAsyncRun(request);
+    int httpResponseCode = request.status;
     
     if (httpResponseCode > 0) {
       Serial.print("HTTP Response code: ");
       Serial.println(httpResponseCode);
       
-      String payload = http.getString();  // Get the response payload
       Serial.println("Response:");
-      Serial.println(payload);
+      Serial.println(request.response);
     } else {
       Serial.print("Error code: ");
       Serial.println(httpResponseCode);
-      Serial.println("Error: " + http.errorToString(httpResponseCode));
+      Serial.println("Error: " + HTTPClient::errorToString(httpResponseCode));
     }
-    
-    http.end();  // Free resources
   } else {
     Serial.println("WiFi not connected!");
   }
@@ -646,14 +787,14 @@ void sendHTTPGetParsed(const char* url) {
       
       String payload = http.getString();
       
-      // Display raw JSON
-      Serial.println("\n--- Raw JSON Response ---");
-      Serial.println(payload);
-      
-      // NOTE: ESP-NOW send moved to publishCoordinates() for compact format
-      
-      // Parse and display in readable format
-      parseAndDisplayJson(payload);
+      if (logLevel >= LOG_DEBUG) {
+        // Display raw JSON
+        Serial.println("\n--- Raw JSON Response ---");
+        Serial.println(payload);
+        
+        // Parse and display in readable format
+        parseAndDisplayJson(payload);
+      }
       
       // Extract and store the data
       extractAndStoreISSData(payload);
@@ -694,33 +835,28 @@ void sendHTTPGetParsed(const char* url) {
 /* Function to send HTTP POST request with JSON data */
 void sendHTTPPost(const char* url, const char* jsonData) {
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    
     Serial.println("\n--- HTTP POST Request ---");
     Serial.print("URL: ");
     Serial.println(url);
     Serial.print("Data: ");
     Serial.println(jsonData);
     
-    http.begin(url);  // specifier le url
-    http.addHeader("Content-Type", "application/json");  // specify le type de contenu
-    
-    int httpResponseCode = http.POST(jsonData);  // envoi la requete
+    // corps JSON, Content-Type application/json par défaut
+    HttpAsyncRequest request = {"POST", url, jsonData};
+    httpAsyncRun(request);  // envoi la requete
+    int httpResponseCode = request.status;
     
     if (httpResponseCode > 0) {
       Serial.print("HTTP Response code: ");
       Serial.println(httpResponseCode);
       
-      String response = http.getString();  //recoit la reponse
-      Serial.println("Response:");
-      Serial.println(response);
+      Serial.println("Response:");  //recoit la reponse
+      Serial.println(request.response);
     } else {
       Serial.print("Error code: ");
       Serial.println(httpResponseCode);
-      Serial.println("Error: " + http.errorToString(httpResponseCode));
+      Serial.println("Error: " + HTTPClient::errorToString(httpResponseCode));
     }
-    
-    http.end();  // Free resources
   } else {
     Serial.println("WiFi not connected!");
   }
@@ -729,7 +865,7 @@ void sendHTTPPost(const char* url, const char* jsonData) {
 /* fonction qui envoie une requête HTTP */
 void sendHTTPRequest(const char* url, const char* method, const char* data = nullptr, const char* authToken = nullptr) {
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
+    StallScope scope(STAGE_HTTP);
     
     Serial.println("\n--- HTTP Request ---");
     Serial.print("Method: ");
@@ -737,40 +873,24 @@ void sendHTTPRequest(const char* url, const char* method, const char* data = nul
     Serial.print("URL: ");
     Serial.println(url);
     
-    http.begin(url);
-    
-    // Ajout d'une autorisation si le token est fourni
-    if (authToken != nullptr) {
-      String authHeader = "Bearer ";
-      authHeader += authToken;
-      http.addHeader("Authorization", authHeader);
-    }
-    
-    int httpResponseCode;
+    // Ajout d'une autorisation si le token est fourni (Bearer)
+    HttpAsyncRequest request = {method, url, nullptr, authToken};
     
-    if (strcmp(method, "GET") == 0) {
-      httpResponseCode = http.GET();
-    } else if (strcmp(method, "POST") == 0) {
-      http.addHeader("Content-Type", "application/json");
-      httpResponseCode = http.POST(data ? data : "");
-    } else if (strcmp(method, "PUT") == 0) {
-      http.addHeader("Content-Type", "application/json");
-      httpResponseCode = http.PUT(data ? data : "");
-    } else if (strcmp(method, "DELETE") == 0) {
-      httpResponseCode = http.sendRequest("DELETE");
-    } else {
+    if (strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0) {
+      request.body = data ? data : "";  // JSON
+    } else if (strcmp(method, "GET") != 0 && strcmp(method, "DELETE") != 0) {
       Serial.println("Unsupported HTTP method");
-      http.end();
       return;
     }
+    httpAsyncRun(request);
+    int httpResponseCode = request.status;
     // recoit le code de connection (par exemple 200 pour OK, 404 pour erreur)
     if (httpResponseCode > 0) {
       Serial.print("HTTP Response code: ");
       Serial.println(httpResponseCode);
       
-      String response = http.getString();
       Serial.println("Response:");
-      Serial.println(response);
+      Serial.println(request.response);
     } else if(httpResponseCode == -1) {
       Serial.println("Connection failed");
     } else if(httpResponseCode == -2) {
@@ -779,24 +899,18 @@ void sendHTTPRequest(const char* url, const char* method, const char* data = nul
       Serial.println("Error: Send payload failed");
     } else if(httpResponseCode == -4) {
       Serial.println("Error: Not connected");
-      while(true);
     } else if(httpResponseCode == -11) {
       Serial.println("Error: Read timeout");
-      while(true);
     } else if(httpResponseCode == 400) {
       Serial.println("Error: Bad Request");
-      while(true);
     } else if(httpResponseCode == 404) {
       Serial.println("Error: Not Found");
-      while(true);
     } else {
+      // erreur non gérée: on la signale et on rend la main au lieu de bloquer
       Serial.print("Error code: ");
       Serial.println(httpResponseCode);
-      Serial.println("Error: " + http.errorToString(httpResponseCode));
-      while(true);// boucle infinie en cas d'erreur non gérée
+      Serial.println("Error: " + HTTPClient::errorToString(httpResponseCode));
     }
-    
-    http.end();
   } else {
     Serial.println("WiFi not connected!");
   }
@@ -842,14 +956,20 @@ void connectToNetwork() {
   }
 }
 
-// removed old reconnect() - use mqttReconnect() instead
+// removed old reconnect() - the MQTT task reconnects, see reportMqttState()
 
 void setup() {
   Serial.begin(115200);
   while(!Serial); // Attendre que la connexion série soit établie
-  pinMode(5, OUTPUT);
-  pinMode(6, INPUT);
-  digitalWrite(5, LOW);
+
+  // Restore runtime parameters saved over MQTT
+  commandDispatcherBegin(MQTT_TOPIC_CMD, commandParams, commandParamCount);
+  // Flash-backed sample history, kept across reboots and outages
+  sampleLogBegin();
+  // Ultrasonic sensor: trigger pin 5, echo pin 6, interrupt driven
+  if (!rangerBegin()) {
+    Serial.println("[RANGER] Ranging disabled");
+  }
   delay(100);
  
  // Serial.println("\nStarting ESP32 MQTT Client");
@@ -857,6 +977,9 @@ void setup() {
   // WiFi mode will be set in connectToNetwork()
   
   connectToNetwork();
+
+  // Wall clock for capture / receive / send timestamps
+  clockSyncBegin();
   
   Serial.print("Connected to WiFi, IP: ");
   Serial.println(WiFi.localIP());
@@ -875,6 +998,10 @@ void setup() {
   Serial.println("\n[ESP-NOW] Initializing ESP-NOW...");
   espNowInitialized = initESPNow();
   if (espNowInitialized) {
+    // Not associated: find the channel the receiver listens on
+    if (WiFi.status() != WL_CONNECTED && espnowDiscover) {
+      espnowChannelDiscover(receiverMacAddress);
+    }
     Serial.println("[ESP-NOW] Ready to send data!");
   } else {
     Serial.println("[ESP-NOW] Initialization failed, will not send data");
@@ -922,8 +1049,24 @@ void setup() {
 
   
   client.setServer(mqtt_server, mqtt_port);
+  // Room for a full worst-case history batch plus topic and header
+  static_assert(sizeof(historyBatch) + 64 <= MQTT_ASYNC_PACKET_SIZE, "history batch does not fit an MQTT buffer");
   // enable MQTT message callback
   client.setCallback(callback);
+  // Re-sent by the client whenever the broker has no session for us
+  client.subscribe(MQTT_TOPIC_CMD "/#");
+  client.subscribe(MQTT_TOPIC_HISTORY_QUERY);
+  // Static client id so the broker keeps our persistent session
+  client.begin("esp2Ow", MQTT_USER, MQTT_PASSWORD);
+
+  // Worker tasks for concurrent HTTP requests over pooled connections
+  httpAsyncBegin();
+
+  // Wi-Fi is up: drop to the idle clock and DTIM modem sleep between bursts
+  powerGovernorBegin();
+
+  // Arm the loop watchdog last: setup() may legitimately block for a while
+  stallMonitorBegin();
   
   //reconnect();http://api.open-notify.org/iss-now.json
 }
@@ -931,8 +1074,12 @@ void setup() {
 
 
 void loop() {
+  // Feed the task watchdog once per iteration
+  stallLoopTick();
+
   // Ensure WiFi stays connected
   if (WiFi.status() != WL_CONNECTED) {
+    StallScope scope(STAGE_WIFI);
     Serial.println("WiFi connection lost!");
     showWiFiError(WiFi.status()); // afficher les erreurs de connexion WiFi
     Serial.println("Reconnecting...");
@@ -942,91 +1089,408 @@ void loop() {
     return;
   }
 
-  // Ensure MQTT connection
-  if (!client.connected()) {
-    mqttReconnect();
+  {
+    StallScope scope(STAGE_MQTT);
+    // Report MQTT connection changes (the network task reconnects by itself)
+    reportMqttState();
+
+    // Deliver messages received by the network task
+    client.loop();
+  }
+
+  // Report stalls from previous boots once the broker is reachable
+  if (client.connected() && stallReportPending()) {
+    publishStallReport();
   }
 
-  // Let the MQTT client process incoming messages and keep the connection alive
-  client.loop();
+  {
+    // Full clock and modem awake only while fetching, parsing and publishing
+    PowerBurst burst(restPollerDue(restEndpoints, restEndpointCount) || !historyQueryReported);
+
+    {
+      StallScope scope(STAGE_REST);
+      // Poll every REST endpoint whose period has elapsed (ISS every 10 seconds)
+      restPollerLoop(restEndpoints, restEndpointCount);
+    }
+
+    {
+      StallScope scope(STAGE_PUBLISH);
+      // Publish only when we have new data
+      if (client.connected() && issData.dataValid && issData.timestamp != lastPublishedTimestamp) {
+        publishCoordinates(issData);
+        lastPublishedTimestamp = issData.timestamp;
+      }
+
+      checkDataFreshness();
+      serviceHistoryQuery();
+
+      if (millis() - lastTlsStatsMillis >= tlsStatsIntervalMs) {
+        lastTlsStatsMillis = millis();
+        publishTlsStats();
+        publishMqttStats();
+        publishEspNowStats();
+        publishPowerStats();
+      }
+    }
 
-  // Publish coordinates only when connected
-  // Periodically fetch the ISS API every 10 seconds
-  if (millis() - lastFetchMillis >= fetchIntervalMs) {
-    lastFetchMillis = millis();
-    sendHTTPGetParsed("http://api.open-notify.org/iss-now.json");
+    holdBurstForMqtt(burst.active);
   }
 
-  // Publish only when we have new data
-  if (client.connected() && issData.dataValid && issData.timestamp != lastPublishedTimestamp) {
-    publishCoordinates(issData);
-    lastPublishedTimestamp = issData.timestamp;
+  {
+    StallScope scope(STAGE_DNS);
+    // Refresh cached DNS records before they expire
+    dnsCacheLoop();
   }
-  
+
+  {
+    StallScope scope(STAGE_RANGER);
+    // Publish distance statistics whenever a ranging window closes
+    RangeStats rangeStats;
+    if (rangerLoop(&rangeStats)) {
+      publishRangeStats(rangeStats);
+    }
+  }
+
+  if (espNowInitialized) {
+    StallScope scope(STAGE_ESPNOW);
+    // Follow Wi-Fi channel changes and answer discovery probes
+    espnowChannelLoop();
+  }
+
   // Send ESP-NOW data every 2 seconds (independent of MQTT)
   if (millis() - lastESPNowSendMillis >= espnowSendIntervalMs) {
+    StallScope scope(STAGE_ESPNOW);
     lastESPNowSendMillis = millis();
     
     if (espNowInitialized && issData.dataValid) {
-      // Create compact JSON payload
-      char payload[128];
-      snprintf(payload, sizeof(payload), "{\"latitude\":%.6f,\"longitude\":%.6f,\"timestamp\":%lu}", 
-               issData.latitude, issData.longitude, issData.timestamp);
-      
+      // Compact delta frame instead of JSON (~4-8 bytes vs ~60)
+      CoordSample sample = {coordToFixed(issData.latitude), coordToFixed(issData.longitude), (uint32_t)issData.timestamp};
+      uint8_t frame[COORD_CODEC_MAX_FRAME + 10];
+      size_t frameLen = espnowEncoder.encode(sample, frame, sizeof(frame));
+
+      // Timing trailer: receive delay after capture, send delay after receive (ms, 0 = unknown)
+      SampleTiming timing = sampleTiming(issData);
+      frameLen += varintWrite(timing.rxDelayMs, frame + frameLen, sizeof(frame) - frameLen);
+      frameLen += varintWrite(timing.txDelayMs, frame + frameLen, sizeof(frame) - frameLen);
+
       Serial.println("\n[ESP-NOW] Periodic send (every 2 seconds)...");
-      String espnowPayload = String(payload);
-      sendJsonViaESPNow(espnowPayload);
+      sendFrameViaESPNow(ESPNOW_FRAME_COORD, frame, frameLen);
     }
   }
   
   delay(100); // Reduced delay for more responsive timing
 }
 
-// MQTT reconnect helper using credentials from secrets.h
-void mqttReconnect() {
-  if (client.connected()) return;
-
-  Serial.print("Attempting MQTT connection...");
-  String clientId = "esp32-" + String((uint32_t)ESP.getEfuseMac(), HEX);
-
-  bool connected;
-  // Print which clientId and username we'll try (do NOT print the password)
-  // Use a static clientId as requested
-  const char* staticClientId = "esp2Ow";
-  Serial.print("MQTT clientId: "); Serial.println(staticClientId);
-  Serial.print("MQTT username: "); Serial.println(MQTT_USER[0] ? MQTT_USER : "(none)");
-
-  if (MQTT_USER[0] != '\0') {
-    connected = client.connect(staticClientId, MQTT_USER, MQTT_PASSWORD);
-  } else {
-    connected = client.connect(staticClientId);
-  }
-
-  if (connected) {
-    Serial.println("connected");
-    Serial.println("connected (no subscriptions)");
-  } else {
-    int state = client.state();
-    Serial.print("failed, rc="); Serial.print(state);
-    Serial.print(" ("); Serial.print(mqttStateToString(state)); Serial.println(")");
-  }
+// The network task connects and reconnects on its own: only report changes
+void reportMqttState() {
+  static int lastState = MQTT_ASYNC_DISCONNECTED;
+  int state = client.state();
+  if (state == lastState) return;
+  lastState = state;
+  Serial.print("[MQTT] State: "); Serial.print(state);
+  Serial.print(" ("); Serial.print(mqttStateToString(state)); Serial.println(")");
 }
 // fonction qui publie les coordonnées de l'ISS via MQTT
 void publishCoordinates(const ISSData& data) {
   if (!client.connected()) {
-    mqttReconnect();
-  }
-  if (!client.connected()) {
+    reportMqttState();
     Serial.println("MQTT not connected; cannot publish coordinates");
     return;
   }
 
-  char payload[128];
-  snprintf(payload, sizeof(payload), "{\"latitude\":%.6f,\"longitude\":%.6f,\"timestamp\":%lu}", data.latitude, data.longitude, data.timestamp);
+  // capture = API timestamp, rx = local receive time, tx = local send time (UTC ms)
+  SampleTiming timing = sampleTiming(data);
+  char payload[192];
+  snprintf(payload, sizeof(payload),
+           "{\"latitude\":%.6f,\"longitude\":%.6f,\"timestamp\":%lu,\"rx\":%llu,\"tx\":%llu,\"age_ms\":%lu}",
+           data.latitude, data.longitude, data.timestamp,
+           (unsigned long long)data.receivedUtcMs, (unsigned long long)timing.sendUtcMs,
+           (unsigned long)(timing.rxDelayMs + timing.txDelayMs));
 
   bool res = client.publish(MQTT_TOPIC_COORDS, payload);
   Serial.print("Publish "); Serial.print(MQTT_TOPIC_COORDS); Serial.print(": "); Serial.println(payload);
   Serial.print("Publish result: "); Serial.println(res ? "OK" : "FAIL");
+
+  appendHistorySample(data);
   
   // Note: ESP-NOW sends are now handled in loop() every 2 seconds
-}
\ No newline at end of file
+}
+// publie le lot binaire en cours et repart de zéro
+void flushHistoryBatch() {
+  bool res = client.publish(MQTT_TOPIC_HISTORY, historyBatch, historyBatchLen);
+  Serial.print("Publish "); Serial.print(MQTT_TOPIC_HISTORY); Serial.print(": ");
+  Serial.print(historyBatchCount); Serial.print(" samples in ");
+  Serial.print(historyBatchLen); Serial.print(" bytes -> ");
+  Serial.println(res ? "OK" : "FAIL");
+
+  historyBatchLen = 0;
+  historyBatchCount = 0;
+}
+
+// ajoute un échantillon au lot binaire et publie le lot quand il est plein
+void appendHistorySample(const ISSData& data) {
+  CoordSample sample = {coordToFixed(data.latitude), coordToFixed(data.longitude), (uint32_t)data.timestamp};
+
+  // Each batch starts with a keyframe so it can be decoded on its own
+  if (historyBatchCount == 0) historyEncoder.forceKeyframe();
+  size_t n = historyEncoder.encode(sample, historyBatch + historyBatchLen, sizeof(historyBatch) - historyBatchLen);
+  if (n == 0 && historyBatchCount > 0) {
+    // Buffer full: ship what we have, the sample opens the next batch
+    flushHistoryBatch();
+    historyEncoder.forceKeyframe();
+    n = historyEncoder.encode(sample, historyBatch, sizeof(historyBatch));
+  }
+  if (n == 0) {
+    Serial.println("[HISTORY] Sample does not fit in a batch, dropped");
+    return;
+  }
+  historyBatchLen += n;
+  historyBatchCount++; // only samples actually in the payload
+
+  // Compare with the live value so a batch size lowered over MQTT flushes on the next sample
+  if (historyBatchCount < historyBatchSamples && historyBatchCount < historyBatchMax) return;
+  flushHistoryBatch();
+}
+
+// ========== REST record handlers ==========
+
+void onIssNowRecord(RestEndpoint& endpoint, uint32_t foundMask) {
+  storeISSRecord(*(IssNowRecord*)endpoint.record, foundMask);
+  // Logged whether or not MQTT is up, so consumers can backfill later
+  if (issData.dataValid) {
+    CoordSample sample = {coordToFixed(issData.latitude), coordToFixed(issData.longitude), (uint32_t)issData.timestamp};
+    sampleLogAppend(sample, sampleTiming(issData).rxDelayMs);
+  }
+  Serial.print("[REST] ISS at ");
+  Serial.print(issData.latitude, 4); Serial.print(", ");
+  Serial.print(issData.longitude, 4); Serial.print(" @ ");
+  Serial.println(issData.timestamp);
+}
+
+// Generic feed: publish the record as JSON straight from its schema
+void onAstrosRecord(RestEndpoint& endpoint, uint32_t foundMask) {
+  if (!client.connected()) return;
+
+  char payload[128];
+  if (restRecordToJson(endpoint.fields, endpoint.fieldCount, endpoint.record, payload, sizeof(payload)) == 0) {
+    Serial.println("[REST] astros record too large to publish");
+    return;
+  }
+  bool res = client.publish(MQTT_TOPIC_ASTROS, payload);
+  Serial.print("Publish "); Serial.print(MQTT_TOPIC_ASTROS); Serial.print(": "); Serial.println(payload);
+  Serial.print("Publish result: "); Serial.println(res ? "OK" : "FAIL");
+}
+
+// publie les statistiques de distance via MQTT et ESP-NOW
+void publishRangeStats(const RangeStats& stats) {
+  const RangerCounters& c = rangerCounters();
+  Serial.printf("[RANGER] Window: min %u max %u mean %u p50 %u mm (%u samples, %u rejected, %lu overflows)\n",
+                stats.minMm, stats.maxMm, stats.meanMm, stats.p50Mm, stats.samples, stats.rejected,
+                (unsigned long)c.overflows);
+
+  if (client.connected()) {
+    // Local sensor: capture and receive are both the window end
+    uint64_t captureUtcMs = clockMonoToUtcMs((int64_t)stats.windowEndMillis * 1000);
+    char payload[192];
+    snprintf(payload, sizeof(payload),
+             "{\"min\":%u,\"max\":%u,\"mean\":%u,\"p50\":%u,\"samples\":%u,\"rejected\":%u,\"capture\":%llu,\"tx\":%llu}",
+             stats.minMm, stats.maxMm, stats.meanMm, stats.p50Mm, stats.samples, stats.rejected,
+             (unsigned long long)captureUtcMs, (unsigned long long)clockNowUtcMs());
+    bool res = client.publish(MQTT_TOPIC_DISTANCE, payload);
+    Serial.print("Publish "); Serial.print(MQTT_TOPIC_DISTANCE); Serial.print(": "); Serial.println(payload);
+    Serial.print("Publish result: "); Serial.println(res ? "OK" : "FAIL");
+  }
+
+  if (espNowInitialized) {
+    RangeStatsFrame frame = {stats.minMm, stats.maxMm, stats.meanMm, stats.p50Mm, stats.samples, stats.rejected};
+    sendFrameViaESPNow(ESPNOW_FRAME_RANGE_STATS, (const uint8_t*)&frame, sizeof(frame));
+  }
+}
+
+// alerte quand la donnée ISS devient trop vieille (et quand elle redevient fraîche)
+void checkDataFreshness() {
+  if (!issData.dataValid || !clockSynced()) return;
+
+  uint64_t now = clockNowUtcMs();
+  uint64_t captureUtcMs = (uint64_t)issData.timestamp * 1000;
+  uint64_t ageMs = now > captureUtcMs ? now - captureUtcMs : 0;
+  bool stale = ageMs > staleThresholdMs;
+  if (stale == staleAlerted) return;
+  staleAlerted = stale;
+
+  char payload[96];
+  snprintf(payload, sizeof(payload), "{\"alert\":\"%s\",\"age_ms\":%llu}",
+           stale ? "stale" : "fresh", (unsigned long long)ageMs);
+  Serial.print("[CLOCK] Data freshness: "); Serial.println(payload);
+  if (client.connected()) {
+    client.publish(MQTT_TOPIC_STATUS, payload);
+  }
+}
+
+// publie les compteurs de handshakes TLS (taux de reprise de session)
+void publishTlsStats() {
+  TlsStats t = tlsStats();
+  uint32_t handshakes = t.fullHandshakes + t.resumedHandshakes;
+  if (handshakes == 0 && t.failedHandshakes == 0) return; // no TLS in use
+
+  char payload[192];
+  snprintf(payload, sizeof(payload),
+           "{\"tls\":{\"full\":%lu,\"resumed\":%lu,\"failed\":%lu,\"avg_full_ms\":%lu,\"avg_resumed_ms\":%lu,\"last_ms\":%lu,\"reused\":%lu}}",
+           (unsigned long)t.fullHandshakes, (unsigned long)t.resumedHandshakes, (unsigned long)t.failedHandshakes,
+           (unsigned long)(t.fullHandshakes ? t.fullHandshakeMsTotal / t.fullHandshakes : 0),
+           (unsigned long)(t.resumedHandshakes ? t.resumedHandshakeMsTotal / t.resumedHandshakes : 0),
+           (unsigned long)t.lastHandshakeMs, (unsigned long)t.reusedConnections);
+  Serial.print("[TLS] "); Serial.println(payload);
+  if (client.connected()) {
+    client.publish(MQTT_TOPIC_STATUS, payload);
+  }
+}
+
+// publie les compteurs du client MQTT (fenêtre QoS 1, reprises de session)
+void publishMqttStats() {
+  MqttAsyncStats m = client.stats();
+  char payload[256];
+  snprintf(payload, sizeof(payload),
+           "{\"mqtt\":{\"connects\":%lu,\"resumed\":%lu,\"published\":%lu,\"acked\":%lu,\"resent\":%lu,\"dropped\":%lu,\"received\":%lu,\"avg_ack_ms\":%lu,\"inflight\":%u,\"queued\":%u}}",
+           (unsigned long)m.connects, (unsigned long)m.sessionsResumed, (unsigned long)m.published,
+           (unsigned long)m.acked, (unsigned long)m.resent, (unsigned long)m.dropped, (unsigned long)m.received,
+           (unsigned long)(m.acked ? m.ackRttMsTotal / m.acked : 0), m.inflight, m.queued);
+  Serial.print("[MQTT] "); Serial.println(payload);
+  if (client.connected()) {
+    client.publish(MQTT_TOPIC_STATUS, payload);
+  }
+}
+
+// publie les compteurs de suivi du canal ESP-NOW (changements, trames perdues)
+void publishEspNowStats() {
+  const EspNowChannelStats& e = espnowChannelStats();
+  if (e.channelChanges == 0 && e.probesAnswered == 0 && e.discoveries == 0 && e.discoveryFailures == 0) return;
+
+  char payload[224];
+  snprintf(payload, sizeof(payload),
+           "{\"espnow\":{\"channel\":%u,\"changes\":%lu,\"lost\":%lu,\"last_recovery_ms\":%lu,\"max_recovery_ms\":%lu,\"probes\":%lu,\"discovered\":%lu,\"discovery_failed\":%lu}}",
+           e.channel, (unsigned long)e.channelChanges, (unsigned long)e.framesLost,
+           (unsigned long)e.lastRecoveryMs, (unsigned long)e.maxRecoveryMs, (unsigned long)e.probesAnswered,
+           (unsigned long)e.discoveries, (unsigned long)e.discoveryFailures);
+  Serial.print("[ESP-NOW] "); Serial.println(payload);
+  if (client.connected()) {
+    client.publish(MQTT_TOPIC_STATUS, payload);
+  }
+}
+
+// publie le temps passé dans chaque état d'alimentation et l'énergie estimée par cycle
+void publishPowerStats() {
+  static PowerStats last = {};
+  PowerStats p = powerGovernorStats();
+  uint32_t cycles = p.bursts - last.bursts;
+  uint64_t energyUj = p.energyUj - last.energyUj;
+  last = p;
+
+  char payload[256];
+  snprintf(payload, sizeof(payload),
+           "{\"power\":{\"mode\":\"%s\",\"enabled\":%d,\"mhz\":[%lu,%lu],\"burst_ms\":%llu,\"idle_ms\":%llu,\"full_ms\":%llu,\"bursts\":%lu,\"energy_mj\":%llu,\"mj_per_cycle\":%llu}}",
+           powerModeName(p.mode), p.enabled ? 1 : 0, (unsigned long)p.minMhz, (unsigned long)p.maxMhz,
+           (unsigned long long)p.burstMs, (unsigned long long)p.idleMs, (unsigned long long)p.fullMs,
+           (unsigned long)p.bursts, (unsigned long long)(p.energyUj / 1000),
+           (unsigned long long)(cycles ? energyUj / 1000 / cycles : 0));
+  Serial.print("[POWER] "); Serial.println(payload);
+  if (client.connected()) {
+    client.publish(MQTT_TOPIC_STATUS, payload);
+  }
+}
+
+// garde le modem éveillé tant que des messages attendent leur PUBACK
+void holdBurstForMqtt(bool burstActive) {
+  bool pending = client.connected() && client.pending() > 0;
+  if (burstActive && pending) {
+    if (!mqttBurstHeld) powerBurstBegin();
+    mqttBurstHeld = true;
+    mqttBurstSinceMillis = millis();
+  } else if (mqttBurstHeld && (!pending || millis() - mqttBurstSinceMillis >= mqttBurstMaxMs)) {
+    powerBurstEnd();
+    mqttBurstHeld = false;
+  }
+}
+
+// publie le rapport des blocages enregistrés en mémoire RTC (une fois par démarrage)
+void publishStallReport() {
+  char payload[512];
+  if (stallFormatReport(payload, sizeof(payload)) == 0) return;
+  Serial.print("[STALL] "); Serial.println(payload);
+  if (client.publish(MQTT_TOPIC_STATUS, payload)) {
+    stallReportDone();
+  }
+}
+
+// démarre une requête "<de> <à>" (secondes Unix) sur l'historique en flash
+void startHistoryQuery(const byte* payload, unsigned int length) {
+  char text[32];
+  size_t n = length < sizeof(text) - 1 ? length : sizeof(text) - 1;
+  memcpy(text, payload, n);
+  text[n] = '\0';
+
+  char* end;
+  uint32_t from = strtoul(text, &end, 10);
+  uint32_t to = strtoul(end, nullptr, 10);
+  if (to == 0) to = 0xFFFFFFFE; // open-ended: everything since <from>
+
+  // A new query replaces the one in progress
+  historyQueryFrom = from;
+  historyQueryTo = to;
+  historyQuerySamples = 0;
+  historyQueryChunks = 0;
+  historyQueryReported = false;
+  historyQueryBlockedMillis = 0;
+  if (!sampleLogSeek(from, to, &historyQuery)) historyQuery.done = true;
+  Serial.printf("[LOG] History query %lu..%lu\n", (unsigned long)from, (unsigned long)to);
+}
+
+// envoie un morceau de la réponse (au plus historyBatchMax échantillons) par appel
+void serviceHistoryQuery() {
+  if (historyQueryReported) return;
+  if (!client.connected()) {
+    // Chunks already queued may be lost with the session: stop here, report on reconnect
+    historyQuery.done = true;
+    return;
+  }
+
+  if (!historyQuery.done) {
+    SampleLogCursor rewind = historyQuery;
+    SampleLogRecord records[historyBatchMax];
+    size_t count = sampleLogRead(&historyQuery, records, historyBatchMax);
+    if (count > 0) {
+      // Each chunk starts with a keyframe, so chunks decode independently
+      CoordStreamEncoder encoder(historyBatchMax);
+      uint8_t chunk[historyBatchMax * COORD_CODEC_MAX_FRAME];
+      size_t len = 0;
+      for (size_t i = 0; i < count; i++) {
+        CoordSample sample = {records[i].latE4, records[i].lonE4, records[i].timestamp};
+        len += encoder.encode(sample, chunk + len, sizeof(chunk) - len);
+      }
+      if (client.publish(MQTT_TOPIC_HISTORY_REPLY, chunk, len)) {
+        historyQuerySamples += count;
+        historyQueryChunks++;
+        historyQueryBlockedMillis = 0;
+      } else {
+        // Pool or in-flight window full: re-read the same records next loop
+        historyQuery = rewind;
+        if (historyQueryBlockedMillis == 0) historyQueryBlockedMillis = millis();
+        if (millis() - historyQueryBlockedMillis >= historyQueryTimeoutMs) {
+          Serial.println("[LOG] History reply stuck, giving up");
+          historyQuery.done = true; // the status shows how far the reply got
+        }
+      }
+    }
+    if (!historyQuery.done) return;
+  }
+
+  const SampleLogStats& stats = sampleLogStats();
+  char payload[160];
+  snprintf(payload, sizeof(payload),
+           "{\"history_query\":{\"from\":%lu,\"to\":%lu,\"samples\":%lu,\"chunks\":%lu,\"oldest\":%lu,\"newest\":%lu}}",
+           (unsigned long)historyQueryFrom, (unsigned long)historyQueryTo, (unsigned long)historyQuerySamples, (unsigned long)historyQueryChunks,
+           (unsigned long)stats.oldestTs, (unsigned long)stats.newestTs);
+  if (!client.publish(MQTT_TOPIC_STATUS, payload)) return; // backpressure, retry next loop
+  historyQueryReported = true;
+  Serial.print("[LOG] "); Serial.println(payload);
+}
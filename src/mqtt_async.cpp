@@ -0,0 +1,567 @@
+#include <WiFi.h>
+#include <esp_random.h>
+#include "mqtt_async.h"
+
+enum {
+  PKT_CONNECT = 1,
+  PKT_CONNACK = 2,
+  PKT_PUBLISH = 3,
+  PKT_PUBACK = 4,
+  PKT_SUBSCRIBE = 8,
+  PKT_SUBACK = 9,
+  PKT_PINGREQ = 12,
+  PKT_PINGRESP = 13
+};
+
+static const uint32_t BACKOFF_MIN_MS = 1000;
+static const uint32_t BACKOFF_MAX_MS = 30000;
+static const uint32_t CONNACK_TIMEOUT_MS = 10000;
+
+// MQTT remaining length, 1-4 bytes
+static size_t writeLength(uint8_t* out, size_t len) {
+  size_t n = 0;
+  do {
+    uint8_t b = len & 0x7F;
+    len >>= 7;
+    if (len) b |= 0x80;
+    out[n++] = b;
+  } while (len);
+  return n;
+}
+
+static size_t lengthBytes(size_t len) {
+  return len < 128 ? 1 : len < 16384 ? 2 : len < 2097152 ? 3 : 4;
+}
+
+static size_t writeString(uint8_t* out, const char* s, size_t len) {
+  out[0] = (uint8_t)(len >> 8);
+  out[1] = (uint8_t)len;
+  memcpy(out + 2, s, len);
+  return len + 2;
+}
+
+MqttAsyncClient::MqttAsyncClient(WiFiClient& transport)
+    : transport(transport), host(nullptr), port(1883), clientId(nullptr), user(nullptr), password(nullptr),
+      cleanSession(false), keepAliveS(15), window(4), callback(nullptr), task(nullptr),
+      outQueue(nullptr), inQueue(nullptr), subscriptionCount(0), waitingCount(0), inflightCount(0),
+      lastPacketId(0), lastSendMillis(0), pingSentMillis(0), pingOutstanding(false),
+      backoffMs(BACKOFF_MIN_MS), nextAttemptMillis(0), rxStage(RX_HEADER), rxHeader(0),
+      rxLengthShift(0), rxLength(0), rxFilled(0), isConnected(false), connState(MQTT_ASYNC_DISCONNECTED) {
+  mux = portMUX_INITIALIZER_UNLOCKED;
+  memset(pool, 0, sizeof(pool));
+  memset(subscriptions, 0, sizeof(subscriptions));
+  memset(&counters, 0, sizeof(counters));
+}
+
+void MqttAsyncClient::setServer(const char* h, uint16_t p) {
+  host = h;
+  port = p;
+}
+
+void MqttAsyncClient::setCallback(MqttAsyncCallback cb) {
+  callback = cb;
+}
+
+void MqttAsyncClient::setInflightWindow(uint8_t w) {
+  window = w < 1 ? 1 : w > MQTT_ASYNC_MAX_INFLIGHT ? MQTT_ASYNC_MAX_INFLIGHT : w;
+}
+
+void MqttAsyncClient::setKeepAlive(uint16_t seconds) {
+  keepAliveS = seconds;
+}
+
+bool MqttAsyncClient::begin(const char* id, const char* u, const char* pw, bool clean) {
+  if (task != nullptr || host == nullptr) return false;
+  clientId = id;
+  user = (u && u[0]) ? u : nullptr;
+  password = pw;
+  cleanSession = clean;
+
+  outQueue = xQueueCreate(MQTT_ASYNC_POOL_SIZE, sizeof(int8_t));
+  inQueue = xQueueCreate(MQTT_ASYNC_POOL_SIZE, sizeof(int8_t));
+  if (outQueue == nullptr || inQueue == nullptr) return false;
+
+  // 8 KB: a TLS handshake runs on this stack when MQTT_USE_TLS is set
+  return xTaskCreatePinnedToCore(taskEntry, "mqtt", 8192, this, 2, &task, tskNO_AFFINITY) == pdPASS;
+}
+
+// ========== Buffer pool ==========
+
+int MqttAsyncClient::allocBuffer() {
+  int found = -1;
+  portENTER_CRITICAL(&mux);
+  for (uint8_t i = 0; i < MQTT_ASYNC_POOL_SIZE; i++) {
+    if (pool[i].state == BUF_FREE) {
+      pool[i].state = BUF_OUTBOUND; // reserved, caller sets the final state
+      found = i;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&mux);
+  return found;
+}
+
+void MqttAsyncClient::freeBuffer(int index) {
+  portENTER_CRITICAL(&mux);
+  pool[index].state = BUF_FREE;
+  portEXIT_CRITICAL(&mux);
+}
+
+uint16_t MqttAsyncClient::nextPacketId() {
+  // Skip 0 and ids still waiting for their PUBACK
+  for (;;) {
+    if (++lastPacketId == 0) lastPacketId = 1;
+    bool inUse = false;
+    for (uint8_t i = 0; i < inflightCount; i++) {
+      if (pool[inflight[i]].packetId == lastPacketId) inUse = true;
+    }
+    if (!inUse) return lastPacketId;
+  }
+}
+
+// ========== Application side ==========
+
+bool MqttAsyncClient::publish(const char* topic, const char* payload, uint8_t qos) {
+  return publish(topic, (const uint8_t*)payload, strlen(payload), qos);
+}
+
+bool MqttAsyncClient::publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+  if (qos > 1) qos = 1;
+  size_t topicLen = strlen(topic);
+  size_t remaining = 2 + topicLen + (qos ? 2 : 0) + length;
+  size_t total = 1 + lengthBytes(remaining) + remaining;
+
+  int index = -1;
+  if (total <= MQTT_ASYNC_PACKET_SIZE && (qos > 0 || isConnected) && outQueue != nullptr) {
+    index = allocBuffer();
+  }
+  if (index < 0) {
+    portENTER_CRITICAL(&mux);
+    counters.dropped++;
+    portEXIT_CRITICAL(&mux);
+    return false;
+  }
+
+  Buffer& b = pool[index];
+  uint8_t* p = b.data;
+  *p++ = (PKT_PUBLISH << 4) | (qos << 1);
+  p += writeLength(p, remaining);
+  p += writeString(p, topic, topicLen);
+  b.idOffset = p - b.data;
+  if (qos) p += 2; // packet id, assigned when the packet enters the window
+  memcpy(p, payload, length);
+  b.length = (uint16_t)total;
+  b.qos = qos;
+  b.packetId = 0;
+
+  int8_t i8 = (int8_t)index;
+  xQueueSend(outQueue, &i8, 0); // never full: one slot per pool buffer
+  return true;
+}
+
+bool MqttAsyncClient::subscribe(const char* filter, uint8_t qos) {
+  bool ok = false;
+  portENTER_CRITICAL(&mux);
+  if (subscriptionCount < MQTT_ASYNC_MAX_SUBSCRIPTIONS && strlen(filter) < sizeof(subscriptions[0].filter)) {
+    Subscription& s = subscriptions[subscriptionCount++];
+    strlcpy(s.filter, filter, sizeof(s.filter));
+    s.qos = qos > 1 ? 1 : qos;
+    s.sent = false;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&mux);
+  return ok;
+}
+
+void MqttAsyncClient::loop() {
+  if (inQueue == nullptr) return;
+  int8_t index;
+  while (xQueueReceive(inQueue, &index, 0) == pdTRUE) {
+    Buffer& b = pool[index];
+    if (callback) callback((char*)b.data, b.data + b.topicLength + 1, b.length);
+    freeBuffer(index);
+  }
+}
+
+MqttAsyncStats MqttAsyncClient::stats() const {
+  portENTER_CRITICAL(&mux);
+  MqttAsyncStats s = counters;
+  portEXIT_CRITICAL(&mux);
+  return s;
+}
+
+uint8_t MqttAsyncClient::pending() const {
+  uint8_t count = 0;
+  portENTER_CRITICAL(&mux);
+  for (uint8_t i = 0; i < MQTT_ASYNC_POOL_SIZE; i++) {
+    if (pool[i].state == BUF_OUTBOUND || pool[i].state == BUF_INFLIGHT) count++;
+  }
+  portEXIT_CRITICAL(&mux);
+  return count;
+}
+
+// ========== Network task ==========
+
+void MqttAsyncClient::taskEntry(void* arg) {
+  ((MqttAsyncClient*)arg)->run();
+}
+
+void MqttAsyncClient::run() {
+  for (;;) {
+    if (!isConnected) {
+      // Keep accepting work so QoS 1 messages are held while offline
+      sendQueued();
+      if (WiFi.status() == WL_CONNECTED && (long)(millis() - nextAttemptMillis) >= 0) {
+        if (connectBroker()) {
+          backoffMs = BACKOFF_MIN_MS;
+        } else {
+          // Jittered so a fleet does not reconnect in lockstep after an outage
+          uint32_t delayMs = backoffMs / 2 + esp_random() % (backoffMs / 2 + 1);
+          nextAttemptMillis = millis() + delayMs;
+          backoffMs = backoffMs * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : backoffMs * 2;
+        }
+      }
+      vTaskDelay(pdMS_TO_TICKS(50));
+      continue;
+    }
+
+    readIncoming();
+    if (isConnected) sendSubscriptions();
+    if (isConnected) sendQueued();
+    if (isConnected) checkTimers();
+
+    // Sleep until something is published, at most 10 ms
+    int8_t peeked;
+    xQueuePeek(outQueue, &peeked, pdMS_TO_TICKS(10));
+  }
+}
+
+bool MqttAsyncClient::writePacket(const uint8_t* data, size_t length) {
+  if (transport.write(data, length) != length) {
+    dropConnection(MQTT_ASYNC_CONNECTION_LOST);
+    return false;
+  }
+  lastSendMillis = millis();
+  return true;
+}
+
+void MqttAsyncClient::sendControl(uint8_t type, uint16_t packetId) {
+  uint8_t pkt[4] = {(uint8_t)(type << 4), 2, (uint8_t)(packetId >> 8), (uint8_t)packetId};
+  writePacket(pkt, sizeof(pkt));
+}
+
+bool MqttAsyncClient::connectBroker() {
+  Serial.printf("[MQTT] Connecting to %s:%u as %s\n", host, port, clientId);
+  if (!transport.connect(host, port)) {
+    connState = MQTT_ASYNC_CONNECT_FAILED;
+    Serial.println("[MQTT] TCP connect failed");
+    return false;
+  }
+
+  // CONNECT: variable header + client id [+ user + password]
+  uint8_t pkt[256];
+  uint8_t body[250];
+  size_t n = writeString(body, "MQTT", 4);
+  body[n++] = 4; // protocol level 3.1.1
+  uint8_t flags = cleanSession ? 0x02 : 0x00;
+  if (user) flags |= 0x80 | (password ? 0x40 : 0);
+  body[n++] = flags;
+  body[n++] = (uint8_t)(keepAliveS >> 8);
+  body[n++] = (uint8_t)keepAliveS;
+  size_t idLen = strlen(clientId);
+  size_t userLen = user ? strlen(user) : 0;
+  size_t passLen = (user && password) ? strlen(password) : 0;
+  if (n + 6 + idLen + userLen + passLen > sizeof(body)) {
+    Serial.println("[MQTT] Credentials too long");
+    transport.stop();
+    connState = MQTT_ASYNC_CONNECT_FAILED;
+    return false;
+  }
+  n += writeString(body + n, clientId, idLen);
+  if (user) n += writeString(body + n, user, userLen);
+  if (user && password) n += writeString(body + n, password, passLen);
+
+  pkt[0] = PKT_CONNECT << 4;
+  size_t h = 1 + writeLength(pkt + 1, n);
+  memcpy(pkt + h, body, n);
+  if (transport.write(pkt, h + n) != h + n) {
+    transport.stop();
+    connState = MQTT_ASYNC_CONNECT_FAILED;
+    return false;
+  }
+
+  // CONNACK: 0x20 0x02 <session present> <return code>
+  unsigned long start = millis();
+  while (transport.available() < 4) {
+    if (millis() - start > CONNACK_TIMEOUT_MS || !transport.connected()) {
+      transport.stop();
+      connState = MQTT_ASYNC_CONNECTION_TIMEOUT;
+      Serial.println("[MQTT] No CONNACK");
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  uint8_t ack[4];
+  transport.read(ack, sizeof(ack));
+  if (ack[0] != (PKT_CONNACK << 4) || ack[3] != 0) {
+    transport.stop();
+    connState = ack[0] == (PKT_CONNACK << 4) ? ack[3] : MQTT_ASYNC_CONNECT_FAILED;
+    Serial.printf("[MQTT] Connection refused, rc=%d\n", connState);
+    return false;
+  }
+  bool sessionPresent = ack[2] & 0x01;
+
+  rxStage = RX_HEADER;
+  pingOutstanding = false;
+  lastSendMillis = millis();
+
+  portENTER_CRITICAL(&mux);
+  counters.connects++;
+  if (sessionPresent) counters.sessionsResumed++;
+  // The broker forgot our subscriptions along with the session
+  if (!sessionPresent) {
+    for (uint8_t i = 0; i < subscriptionCount; i++) subscriptions[i].sent = false;
+  }
+  portEXIT_CRITICAL(&mux);
+
+  isConnected = true;
+  connState = MQTT_ASYNC_CONNECTED;
+  Serial.printf("[MQTT] Connected (%s session), %u message(s) to resend\n",
+                sessionPresent ? "resumed" : "new", inflightCount);
+
+  // Unacknowledged PUBLISHes go out again first, in their original order
+  for (uint8_t i = 0; i < inflightCount && isConnected; i++) {
+    Buffer& b = pool[inflight[i]];
+    b.data[0] |= 0x08; // DUP
+    if (writePacket(b.data, b.length)) {
+      b.sentMillis = millis();
+      portENTER_CRITICAL(&mux);
+      counters.resent++;
+      portEXIT_CRITICAL(&mux);
+    }
+  }
+  return isConnected;
+}
+
+void MqttAsyncClient::dropConnection(int newState) {
+  if (!isConnected) return;
+  transport.stop();
+  isConnected = false;
+  connState = newState;
+  nextAttemptMillis = millis(); // first retry right away, then back off
+  Serial.printf("[MQTT] Connection dropped (rc=%d), %u message(s) unacknowledged\n", newState, inflightCount);
+}
+
+void MqttAsyncClient::sendSubscriptions() {
+  for (uint8_t i = 0; i < MQTT_ASYNC_MAX_SUBSCRIPTIONS && isConnected; i++) {
+    Subscription s;
+    portENTER_CRITICAL(&mux);
+    bool pending = i < subscriptionCount && !subscriptions[i].sent;
+    if (pending) s = subscriptions[i];
+    portEXIT_CRITICAL(&mux);
+    if (!pending) continue;
+
+    uint8_t pkt[80];
+    size_t filterLen = strlen(s.filter);
+    size_t remaining = 2 + 2 + filterLen + 1;
+    size_t n = 0;
+    pkt[n++] = (PKT_SUBSCRIBE << 4) | 0x02;
+    n += writeLength(pkt + n, remaining);
+    uint16_t id = nextPacketId();
+    pkt[n++] = (uint8_t)(id >> 8);
+    pkt[n++] = (uint8_t)id;
+    n += writeString(pkt + n, s.filter, filterLen);
+    pkt[n++] = s.qos;
+    if (!writePacket(pkt, n)) return;
+
+    portENTER_CRITICAL(&mux);
+    subscriptions[i].sent = true;
+    portEXIT_CRITICAL(&mux);
+    Serial.printf("[MQTT] Subscribed to %s\n", s.filter);
+  }
+}
+
+void MqttAsyncClient::sendQueued() {
+  int8_t index;
+  while (xQueueReceive(outQueue, &index, 0) == pdTRUE) {
+    Buffer& b = pool[index];
+    if (b.qos == 0) {
+      // QoS 0 is fire and forget: written now or dropped
+      bool sent = isConnected && writePacket(b.data, b.length);
+      portENTER_CRITICAL(&mux);
+      if (sent) counters.published++;
+      else counters.dropped++;
+      portEXIT_CRITICAL(&mux);
+      freeBuffer(index);
+    } else {
+      waiting[waitingCount++] = index;
+    }
+  }
+
+  // Fill the window with QoS 1 messages, oldest first
+  while (isConnected && waitingCount > 0 && inflightCount < window) {
+    index = waiting[0];
+    Buffer& b = pool[index];
+    b.packetId = nextPacketId();
+    b.data[b.idOffset] = (uint8_t)(b.packetId >> 8);
+    b.data[b.idOffset + 1] = (uint8_t)b.packetId;
+    if (!writePacket(b.data, b.length)) break; // stays at the head of the queue
+
+    memmove(waiting, waiting + 1, --waitingCount);
+    b.sentMillis = millis();
+    portENTER_CRITICAL(&mux);
+    b.state = BUF_INFLIGHT;
+    counters.published++;
+    portEXIT_CRITICAL(&mux);
+    inflight[inflightCount++] = index;
+  }
+
+  portENTER_CRITICAL(&mux);
+  counters.inflight = inflightCount;
+  counters.queued = waitingCount;
+  portEXIT_CRITICAL(&mux);
+}
+
+void MqttAsyncClient::readIncoming() {
+  int avail;
+  while (isConnected && (avail = transport.available()) > 0) {
+    switch (rxStage) {
+      case RX_HEADER:
+        rxHeader = (uint8_t)transport.read();
+        rxLength = 0;
+        rxLengthShift = 0;
+        rxStage = RX_LENGTH;
+        break;
+
+      case RX_LENGTH: {
+        uint8_t b = (uint8_t)transport.read();
+        rxLength |= (uint32_t)(b & 0x7F) << rxLengthShift;
+        rxLengthShift += 7;
+        if (b & 0x80) {
+          if (rxLengthShift > 21) dropConnection(MQTT_ASYNC_CONNECTION_LOST); // malformed
+          break;
+        }
+        rxFilled = 0;
+        rxStage = RX_BODY;
+        if (rxLength == 0) {
+          handlePacket(rxHeader, rxBuffer, 0);
+          rxStage = RX_HEADER;
+        }
+        break;
+      }
+
+      case RX_BODY: {
+        size_t want = rxLength - rxFilled;
+        if (want > (size_t)avail) want = avail;
+        if (rxLength <= sizeof(rxBuffer)) {
+          rxFilled += transport.read(rxBuffer + rxFilled, want);
+        } else {
+          // Too large for any buffer: read and discard
+          uint8_t scratch[64];
+          rxFilled += transport.read(scratch, want < sizeof(scratch) ? want : sizeof(scratch));
+        }
+        if (rxFilled < rxLength) break;
+        if (rxLength <= sizeof(rxBuffer)) {
+          handlePacket(rxHeader, rxBuffer, rxLength);
+        } else {
+          portENTER_CRITICAL(&mux);
+          counters.dropped++;
+          portEXIT_CRITICAL(&mux);
+        }
+        rxStage = RX_HEADER;
+        break;
+      }
+    }
+  }
+}
+
+void MqttAsyncClient::handlePacket(uint8_t header, const uint8_t* body, size_t length) {
+  switch (header >> 4) {
+    case PKT_PUBLISH: {
+      if (length < 2) return;
+      uint8_t qos = (header >> 1) & 0x03;
+      size_t topicLen = ((size_t)body[0] << 8) | body[1];
+      size_t offset = 2 + topicLen + (qos ? 2 : 0);
+      if (offset > length) return;
+      uint16_t packetId = qos ? (((uint16_t)body[2 + topicLen] << 8) | body[3 + topicLen]) : 0;
+      size_t payloadLen = length - offset;
+
+      // Inbound layout: topic, NUL, payload (fits: rxBuffer has the same size)
+      int index = allocBuffer();
+      if (index < 0) {
+        // No PUBACK: the broker redelivers a QoS 1 message after the next reconnect
+        portENTER_CRITICAL(&mux);
+        counters.dropped++;
+        portEXIT_CRITICAL(&mux);
+        return;
+      }
+      Buffer& b = pool[index];
+      memcpy(b.data, body + 2, topicLen);
+      b.data[topicLen] = '\0';
+      memcpy(b.data + topicLen + 1, body + offset, payloadLen);
+      b.topicLength = (uint16_t)topicLen;
+      b.length = (uint16_t)payloadLen;
+      portENTER_CRITICAL(&mux);
+      b.state = BUF_INBOUND;
+      counters.received++;
+      portEXIT_CRITICAL(&mux);
+      int8_t i8 = (int8_t)index;
+      xQueueSend(inQueue, &i8, 0);
+
+      if (qos == 1) sendControl(PKT_PUBACK, packetId);
+      break;
+    }
+
+    case PKT_PUBACK: {
+      if (length < 2) return;
+      uint16_t packetId = ((uint16_t)body[0] << 8) | body[1];
+      for (uint8_t i = 0; i < inflightCount; i++) {
+        Buffer& b = pool[inflight[i]];
+        if (b.packetId != packetId) continue;
+        portENTER_CRITICAL(&mux);
+        counters.acked++;
+        counters.ackRttMsTotal += millis() - b.sentMillis;
+        portEXIT_CRITICAL(&mux);
+        freeBuffer(inflight[i]);
+        memmove(inflight + i, inflight + i + 1, inflightCount - i - 1);
+        inflightCount--;
+        break;
+      }
+      break;
+    }
+
+    case PKT_PINGRESP:
+      pingOutstanding = false;
+      break;
+
+    default:
+      break; // SUBACK and anything else: nothing to track
+  }
+}
+
+void MqttAsyncClient::checkTimers() {
+  unsigned long now = millis();
+
+  if (!transport.connected()) {
+    dropConnection(MQTT_ASYNC_CONNECTION_LOST);
+    return;
+  }
+
+  uint32_t keepAliveMs = (uint32_t)keepAliveS * 1000;
+  if (pingOutstanding && now - pingSentMillis > keepAliveMs) {
+    dropConnection(MQTT_ASYNC_CONNECTION_TIMEOUT);
+    return;
+  }
+  if (keepAliveMs && !pingOutstanding && now - lastSendMillis >= keepAliveMs) {
+    uint8_t ping[2] = {PKT_PINGREQ << 4, 0};
+    if (writePacket(ping, sizeof(ping))) {
+      pingOutstanding = true;
+      pingSentMillis = now;
+    }
+  }
+
+  // The oldest unacknowledged message waited too long: assume a dead link
+  if (inflightCount > 0 && now - pool[inflight[0]].sentMillis > MQTT_ASYNC_ACK_TIMEOUT_MS) {
+    dropConnection(MQTT_ASYNC_CONNECTION_TIMEOUT);
+  }
+}
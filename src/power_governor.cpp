@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_wifi.h>
+#include "power_governor.h"
+
+enum PowerState : uint8_t { STATE_IDLE, STATE_BURST, STATE_FULL };
+
+static PowerStats stats = {POWER_MODE_NONE, true, POWER_DEFAULT_MAX_MHZ, POWER_DEFAULT_MIN_MHZ, 0, 0, 0, 0, 0};
+static esp_pm_lock_handle_t cpuLock = nullptr;
+static PowerState state = STATE_FULL;
+static uint8_t burstDepth = 0;
+static unsigned long stateSinceMillis = 0;
+
+// Charge the time spent in the current state
+static void account() {
+  unsigned long now = millis();
+  uint32_t elapsed = now - stateSinceMillis;
+  stateSinceMillis = now;
+  if (stats.mode == POWER_MODE_NONE) return;
+
+  switch (state) {
+    case STATE_IDLE: stats.idleMs += elapsed; break;
+    case STATE_BURST: stats.burstMs += elapsed; break;
+    default: stats.fullMs += elapsed; break;
+  }
+}
+
+// Drive the clock and the modem; wasFast = the PM lock is currently held
+static void applyState(PowerState next, bool wasFast) {
+  bool fast = next != STATE_IDLE;
+  if (stats.mode == POWER_MODE_PM) {
+    // The lock is held in both fast states, taken and released once
+    if (fast && !wasFast) esp_pm_lock_acquire(cpuLock);
+    if (!fast && wasFast) esp_pm_lock_release(cpuLock);
+  } else {
+    setCpuFrequencyMhz(fast ? stats.maxMhz : stats.minMhz);
+  }
+  // MIN_MODEM wakes for every DTIM beacon; NONE keeps the receiver on
+  esp_wifi_set_ps(fast ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+}
+
+static void setState(PowerState next) {
+  account();
+  if (stats.mode == POWER_MODE_NONE || next == state) {
+    state = next;
+    return;
+  }
+  applyState(next, state != STATE_IDLE);
+  state = next;
+}
+
+static PowerState restingState() {
+  return stats.enabled ? STATE_IDLE : STATE_FULL;
+}
+
+bool powerGovernorBegin(uint32_t maxMhz, uint32_t minMhz) {
+  stats.maxMhz = maxMhz;
+  stats.minMhz = minMhz;
+
+#if CONFIG_IDF_TARGET_ESP32S3
+  esp_pm_config_esp32s3_t config;
+#else
+  esp_pm_config_esp32_t config;
+#endif
+  config.max_freq_mhz = maxMhz;
+  config.min_freq_mhz = minMhz;
+  config.light_sleep_enable = false; // light sleep would stall the MQTT and ESP-NOW tasks
+
+  esp_err_t err = esp_pm_configure(&config);
+  if (err == ESP_OK && esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "burst", &cpuLock) == ESP_OK) {
+    stats.mode = POWER_MODE_PM;
+  } else {
+    // Arduino core built without CONFIG_PM_ENABLE: ESP_ERR_NOT_SUPPORTED
+    Serial.printf("[POWER] esp_pm unavailable (%s), switching the clock directly\n", esp_err_to_name(err));
+    stats.mode = POWER_MODE_MANUAL;
+  }
+
+  // Applied unconditionally: the radio starts in the Arduino default
+  // (MIN_MODEM), which matches no state when power_save=0 was restored
+  state = burstDepth ? STATE_BURST : restingState();
+  stateSinceMillis = millis();
+  applyState(state, false);
+
+  Serial.printf("[POWER] Governor %s: %lu-%lu MHz, mode %s\n", stats.enabled ? "on" : "off",
+                (unsigned long)minMhz, (unsigned long)maxMhz, powerModeName(stats.mode));
+  return true;
+}
+
+void powerGovernorEnable(bool enabled) {
+  stats.enabled = enabled;
+  if (burstDepth == 0) setState(restingState());
+}
+
+void powerBurstBegin() {
+  if (burstDepth++ > 0 || !stats.enabled) return;
+  stats.bursts++;
+  setState(STATE_BURST);
+}
+
+void powerBurstEnd() {
+  if (burstDepth == 0 || --burstDepth > 0) return;
+  setState(restingState());
+}
+
+PowerStats powerGovernorStats() {
+  account();
+  // mA * mV = uW, times ms = nJ
+  uint64_t nj = (stats.idleMs * POWER_IDLE_MA + stats.burstMs * POWER_BURST_MA + stats.fullMs * POWER_FULL_MA) * POWER_SUPPLY_MV;
+  stats.energyUj = nj / 1000;
+  return stats;
+}
+
+const char* powerModeName(uint8_t mode) {
+  switch (mode) {
+    case POWER_MODE_PM: return "pm";
+    case POWER_MODE_MANUAL: return "manual";
+    default: return "none";
+  }
+}
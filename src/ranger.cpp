@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include "ranger.h"
+
+// Raw echo widths in microseconds, 0 = timeout. Written by the echo ISR and
+// the trigger timer, read by rangerLoop().
+static const uint8_t RING_SIZE = 64; // power of two
+static volatile uint16_t ring[RING_SIZE];
+static volatile uint8_t ringHead = 0;
+static volatile uint8_t ringTail = 0;
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile int64_t echoRiseUs = 0;
+static volatile bool echoPending = false;
+
+static esp_timer_handle_t triggerTimer = nullptr;
+static RangerCounters counters = {};
+
+// Filter / window state (loop context only)
+static uint16_t medianWindow[5];
+static uint8_t medianFill = 0;
+static uint8_t medianPos = 0;
+static uint8_t decimationCount = 0;
+static uint16_t window[RANGER_WINDOW_SAMPLES];
+static uint8_t windowFill = 0;
+static uint16_t windowRejected = 0;
+
+static void IRAM_ATTR ringPush(uint16_t widthUs) {
+  portENTER_CRITICAL_ISR(&ringMux);
+  uint8_t next = (ringHead + 1) & (RING_SIZE - 1);
+  if (next == ringTail) {
+    counters.overflows++;
+  } else {
+    ring[ringHead] = widthUs;
+    ringHead = next;
+  }
+  portEXIT_CRITICAL_ISR(&ringMux);
+}
+
+static void IRAM_ATTR onEchoEdge() {
+  int64_t now = esp_timer_get_time();
+  if (gpio_get_level((gpio_num_t)RANGER_ECHO_PIN)) {
+    echoRiseUs = now;
+  } else if (echoPending) {
+    int64_t width = now - echoRiseUs;
+    echoPending = false;
+    ringPush(width > 0xFFFF ? 0 : (uint16_t)width);
+  }
+}
+
+// esp_timer task context: a 10 us trigger pulse is the only blocking part
+static void onTriggerTimer(void*) {
+  if (echoPending) {
+    // Previous echo never came back
+    echoPending = false;
+    ringPush(0);
+  }
+  if (gpio_get_level((gpio_num_t)RANGER_ECHO_PIN)) {
+    return; // echo line still high, skip this cycle
+  }
+  echoPending = true;
+  gpio_set_level((gpio_num_t)RANGER_TRIGGER_PIN, 1);
+  delayMicroseconds(10);
+  gpio_set_level((gpio_num_t)RANGER_TRIGGER_PIN, 0);
+}
+
+static bool ringPop(uint16_t* widthUs) {
+  bool ok = false;
+  portENTER_CRITICAL(&ringMux);
+  if (ringTail != ringHead) {
+    *widthUs = ring[ringTail];
+    ringTail = (ringTail + 1) & (RING_SIZE - 1);
+    ok = true;
+  }
+  portEXIT_CRITICAL(&ringMux);
+  return ok;
+}
+
+static void sortSmall(uint16_t* v, uint8_t n) {
+  for (uint8_t i = 1; i < n; i++) {
+    uint16_t x = v[i];
+    int8_t j = i - 1;
+    while (j >= 0 && v[j] > x) {
+      v[j + 1] = v[j];
+      j--;
+    }
+    v[j + 1] = x;
+  }
+}
+
+static uint16_t median5() {
+  uint16_t tmp[5];
+  memcpy(tmp, medianWindow, sizeof(uint16_t) * medianFill);
+  sortSmall(tmp, medianFill);
+  return tmp[medianFill / 2];
+}
+
+static void closeWindow(RangeStats* stats) {
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < windowFill; i++) sum += window[i];
+  sortSmall(window, windowFill);
+
+  stats->minMm = window[0];
+  stats->maxMm = window[windowFill - 1];
+  stats->meanMm = (uint16_t)(sum / windowFill);
+  stats->p50Mm = window[windowFill / 2];
+  stats->samples = windowFill;
+  stats->rejected = windowRejected;
+  stats->windowEndMillis = millis();
+
+  windowFill = 0;
+  windowRejected = 0;
+  counters.windows++;
+}
+
+bool rangerBegin() {
+  pinMode(RANGER_TRIGGER_PIN, OUTPUT);
+  pinMode(RANGER_ECHO_PIN, INPUT);
+  digitalWrite(RANGER_TRIGGER_PIN, LOW);
+
+  attachInterrupt(digitalPinToInterrupt(RANGER_ECHO_PIN), onEchoEdge, CHANGE);
+
+  esp_timer_create_args_t args = {};
+  args.callback = onTriggerTimer;
+  args.name = "ranger";
+  if (esp_timer_create(&args, &triggerTimer) != ESP_OK ||
+      esp_timer_start_periodic(triggerTimer, RANGER_SAMPLE_PERIOD_US) != ESP_OK) {
+    Serial.println("[RANGER] Failed to start trigger timer");
+    detachInterrupt(digitalPinToInterrupt(RANGER_ECHO_PIN));
+    return false;
+  }
+
+  Serial.printf("[RANGER] Sampling at %lu Hz, trigger pin %u, echo pin %u\n",
+                1000000UL / RANGER_SAMPLE_PERIOD_US, RANGER_TRIGGER_PIN, RANGER_ECHO_PIN);
+  return true;
+}
+
+bool rangerLoop(RangeStats* stats) {
+  bool windowClosed = false;
+  uint16_t widthUs;
+
+  while (ringPop(&widthUs)) {
+    counters.rawSamples++;
+
+    if (widthUs == 0) {
+      counters.timeouts++;
+      windowRejected++;
+      continue;
+    }
+
+    // Speed of sound 343 m/s, round trip: mm = us * 0.1715
+    uint16_t mm = (uint16_t)(((uint32_t)widthUs * 1715) / 10000);
+    if (mm < RANGER_MIN_MM || mm > RANGER_MAX_MM) {
+      counters.outOfRange++;
+      windowRejected++;
+      continue;
+    }
+
+    // Median of the last 5 valid readings removes single-sample spikes
+    medianWindow[medianPos] = mm;
+    medianPos = (medianPos + 1) % 5;
+    if (medianFill < 5) medianFill++;
+    uint16_t filtered = median5();
+
+    if (++decimationCount < RANGER_DECIMATION) continue;
+    decimationCount = 0;
+
+    window[windowFill++] = filtered;
+    if (windowFill >= RANGER_WINDOW_SAMPLES) {
+      closeWindow(stats);
+      windowClosed = true;
+    }
+  }
+
+  return windowClosed;
+}
+
+const RangerCounters& rangerCounters() {
+  return counters;
+}
@@ -0,0 +1,188 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include "rest_poller.h"
+#include "http_async.h"
+
+// HTTP half of the REST poller (extraction lives in rest_schema.cpp)
+
+// Never let a server's max-age stretch a poll interval past one hour
+static const uint32_t REST_MAX_FRESH_MS = 3600000;
+
+// Endpoints fetched together in one restPollerLoop() call; others wait a loop
+static const size_t REST_MAX_BATCH = 4;
+
+static void copyHeader(HTTPClient& http, const char* name, char* dst, size_t cap) {
+  if (!http.hasHeader(name)) return;
+  String value = http.header(name);
+  strlcpy(dst, value.c_str(), cap);
+}
+
+uint32_t restEffectivePeriodMs(const RestEndpoint& endpoint) {
+  return endpoint.state.freshForMs > endpoint.periodMs ? endpoint.state.freshForMs : endpoint.periodMs;
+}
+
+// Update the freshness lifetime from Cache-Control max-age and Age
+static void updateFreshness(RestEndpoint& endpoint, HTTPClient& http) {
+  long maxAge = restParseMaxAge(http.hasHeader("Cache-Control") ? http.header("Cache-Control").c_str() : nullptr);
+  if (maxAge < 0) {
+    endpoint.state.freshForMs = 0;
+    return;
+  }
+  long age = http.hasHeader("Age") ? http.header("Age").toInt() : 0;
+  if (age < 0) age = 0;
+  long remaining = maxAge - age;
+  // Clamp before scaling: a max-age over ~49 days would overflow the ms value
+  if (remaining > (long)(REST_MAX_FRESH_MS / 1000)) remaining = REST_MAX_FRESH_MS / 1000;
+  endpoint.state.freshForMs = remaining > 0 ? (uint32_t)remaining * 1000 : 0;
+}
+
+// Worker task: conditional request when the server gave us validators last time
+static void restPrepare(HttpAsyncRequest& request, HTTPClient& http) {
+  RestEndpoint::State& st = ((RestEndpoint*)request.context)->state;
+  const char* headerKeys[] = {"Cache-Control", "Age", "ETag", "Last-Modified"};
+  http.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+
+  if (st.etag[0] != '\0') {
+    http.addHeader("If-None-Match", st.etag);
+  }
+  if (st.lastModified[0] != '\0') {
+    http.addHeader("If-Modified-Since", st.lastModified);
+  }
+}
+
+// Worker task: freshness and validators, read before the body
+static void restOnResponse(HttpAsyncRequest& request, HTTPClient& http) {
+  RestEndpoint& endpoint = *(RestEndpoint*)request.context;
+  RestEndpoint::State& st = endpoint.state;
+  if (request.status == HTTP_CODE_NOT_MODIFIED) {
+    updateFreshness(endpoint, http);
+  } else if (request.status == HTTP_CODE_OK) {
+    updateFreshness(endpoint, http);
+    st.etag[0] = '\0';
+    st.lastModified[0] = '\0';
+    copyHeader(http, "ETag", st.etag, sizeof(st.etag));
+    copyHeader(http, "Last-Modified", st.lastModified, sizeof(st.lastModified));
+  }
+}
+
+// Fill request for endpoint. Returns false if the poll cannot start.
+static bool restStartPoll(RestEndpoint& endpoint, HttpAsyncRequest& request) {
+  RestEndpoint::State& st = endpoint.state;
+  st.lastPollMillis = millis();
+  st.pollCount++;
+
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.print("[REST] "); Serial.print(endpoint.name);
+    Serial.println(": WiFi not connected, skipping poll");
+    st.errorCount++;
+    return false;
+  }
+
+  // Pooled transport (keep-alive connection, warm TLS session) is taken by the worker
+  request.method = "GET";
+  request.url = endpoint.url;
+  request.body = nullptr;
+  request.authToken = nullptr;
+  request.contentType = nullptr;
+  request.onPrepare = restPrepare;
+  request.onResponse = restOnResponse;
+  request.context = &endpoint;
+  return true;
+}
+
+// Loop task: check the status, parse the body, hand the record over
+static bool restFinishPoll(RestEndpoint& endpoint, HttpAsyncRequest& request) {
+  RestEndpoint::State& st = endpoint.state;
+  int httpResponseCode = request.status;
+
+  if (httpResponseCode == HTTP_CODE_NOT_MODIFIED) {
+    st.notModifiedCount++;
+    Serial.printf("[REST] %s: 304 Not Modified, next poll in %lu ms\n",
+                  endpoint.name, (unsigned long)restEffectivePeriodMs(endpoint));
+    return false;
+  }
+
+  if (httpResponseCode != HTTP_CODE_OK) {
+    Serial.print("[REST] "); Serial.print(endpoint.name);
+    Serial.print(": HTTP error "); Serial.print(httpResponseCode);
+    Serial.print(" ("); Serial.print(HTTPClient::errorToString(httpResponseCode)); Serial.println(")");
+    st.errorCount++;
+    return false;
+  }
+
+  const String& payload = request.response;
+
+  // Identical body: nothing new to parse or publish
+  uint32_t bodyHash = restBodyHash(payload.c_str(), payload.length());
+  if (st.haveBody && bodyHash == st.bodyHash) {
+    st.unchangedCount++;
+    Serial.printf("[REST] %s: body unchanged (hash %08x), skipping parse\n", endpoint.name, bodyHash);
+    return false;
+  }
+
+  // Single pass over the body fills the typed record
+  memset(endpoint.record, 0, endpoint.recordSize);
+  uint32_t found = restExtract(payload.c_str(), payload.length(), endpoint.fields, endpoint.fieldCount, endpoint.record);
+
+  Serial.printf("[REST] %s: %u bytes, %d/%u fields extracted, next poll in %lu ms\n",
+                endpoint.name, payload.length(), __builtin_popcount(found), endpoint.fieldCount,
+                (unsigned long)restEffectivePeriodMs(endpoint));
+
+  if (found == 0) {
+    st.errorCount++;
+    return false;
+  }
+
+  st.bodyHash = bodyHash;
+  st.haveBody = true;
+
+  if (endpoint.onRecord) {
+    endpoint.onRecord(endpoint, found);
+  }
+  return true;
+}
+
+bool restPollEndpoint(RestEndpoint& endpoint) {
+  HttpAsyncRequest request = {};
+  if (!restStartPoll(endpoint, request)) return false;
+  httpAsyncRun(request);
+  return restFinishPoll(endpoint, request);
+}
+
+// pollCount == 0: never polled yet, fetch right away
+static bool restEndpointDue(const RestEndpoint& endpoint) {
+  return endpoint.state.pollCount == 0 || millis() - endpoint.state.lastPollMillis >= restEffectivePeriodMs(endpoint);
+}
+
+bool restPollerDue(const RestEndpoint* endpoints, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (restEndpointDue(endpoints[i])) return true;
+  }
+  return false;
+}
+
+void restPollerLoop(RestEndpoint* endpoints, size_t count) {
+  static HttpAsyncRequest requests[REST_MAX_BATCH];
+  RestEndpoint* batch[REST_MAX_BATCH];
+  size_t n = 0;
+  for (size_t i = 0; i < count && n < REST_MAX_BATCH; i++) {
+    RestEndpoint& endpoint = endpoints[i];
+    if (restEndpointDue(endpoint) && restStartPoll(endpoint, requests[n])) {
+      batch[n++] = &endpoint;
+    }
+  }
+  if (n == 0) return;
+
+  // Due endpoints are fetched concurrently, then parsed here in order
+  httpAsyncRunAll(requests, n);
+  if (n > 1) {
+    const HttpAsyncStats& hs = httpAsyncStats();
+    Serial.printf("[REST] %u endpoints in %lu ms (%lu ms one at a time)\n", (unsigned)n,
+                  (unsigned long)hs.lastBatchMs, (unsigned long)hs.lastBatchSumMs);
+  }
+  for (size_t i = 0; i < n; i++) {
+    restFinishPoll(*batch[i], requests[i]);
+    requests[i].response = String(); // release the body until the next poll
+  }
+}
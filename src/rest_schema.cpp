@@ -0,0 +1,259 @@
+#include "rest_poller.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Portable half of the REST poller: single-pass JSON extraction and record
+// serialization. No Arduino dependency.
+
+static const uint8_t REST_MAX_DEPTH = 8;
+
+static int findField(const RestField* fields, uint8_t count, uint32_t hash) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (fields[i].pathHash == hash) return i;
+  }
+  return -1;
+}
+
+static void storeInt(uint8_t* dst, uint16_t size, long long v) {
+  if (size == sizeof(int32_t)) {
+    int32_t x = (int32_t)v;
+    memcpy(dst, &x, sizeof(x));
+  } else if (size == sizeof(int64_t)) {
+    int64_t x = (int64_t)v;
+    memcpy(dst, &x, sizeof(x));
+  }
+}
+
+static void storeValue(const RestField& f, void* record, const char* value, size_t len, bool quoted) {
+  uint8_t* dst = (uint8_t*)record + f.offset;
+
+  // Numbers are parsed from a small NUL terminated copy: the body is not
+  // guaranteed to be terminated right after the token
+  char num[32];
+  if (f.type != REST_STRING) {
+    size_t n = len < sizeof(num) - 1 ? len : sizeof(num) - 1;
+    memcpy(num, value, n);
+    num[n] = '\0';
+  }
+
+  switch (f.type) {
+    case REST_FLOAT: {
+      float x = strtof(num, nullptr);
+      memcpy(dst, &x, sizeof(x));
+      break;
+    }
+    case REST_DOUBLE: {
+      double x = strtod(num, nullptr);
+      memcpy(dst, &x, sizeof(x));
+      break;
+    }
+    case REST_INT:
+      storeInt(dst, f.size, strtoll(num, nullptr, 10));
+      break;
+    case REST_UINT:
+      storeInt(dst, f.size, (long long)strtoull(num, nullptr, 10));
+      break;
+    case REST_BOOL: {
+      bool x = (len == 4 && memcmp(value, "true", 4) == 0) || (quoted && len == 1 && value[0] == '1');
+      memcpy(dst, &x, sizeof(x));
+      break;
+    }
+    case REST_STRING: {
+      size_t n = len < (size_t)(f.size - 1) ? len : (size_t)(f.size - 1);
+      memcpy(dst, value, n);
+      dst[n] = '\0';
+      break;
+    }
+  }
+}
+
+uint32_t restExtract(const char* json, size_t len, const RestField* fields, uint8_t fieldCount, void* record) {
+  // Per nesting level: hash of the path leading to it, whether it is an
+  // array, and whether paths below it can match at all
+  struct Level { uint32_t hash; bool isArray; bool valid; };
+  Level stack[REST_MAX_DEPTH + 1];
+  int depth = 0;
+  stack[0] = {REST_HASH_BASIS, false, true};
+
+  uint32_t found = 0;
+  bool expectKey = false;    // inside an object, before a key
+  uint32_t keyHash = 0;      // full path hash of the last key read
+  bool keyValid = false;
+  bool atRoot = true;        // no container opened yet
+
+  size_t pos = 0;
+  while (pos < len) {
+    char c = json[pos];
+
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ':') {
+      pos++;
+      continue;
+    }
+
+    if (c == '{' || c == '[') {
+      bool valid = atRoot || (!stack[depth].isArray && keyValid);
+      uint32_t hash = atRoot ? REST_HASH_BASIS : keyHash;
+      if (!atRoot) {
+        if (depth >= REST_MAX_DEPTH) return found; // too deep for this parser
+        depth++;
+      }
+      stack[depth] = {hash, c == '[', valid};
+      atRoot = false;
+      expectKey = (c == '{');
+      keyValid = false;
+      pos++;
+      continue;
+    }
+
+    if (c == '}' || c == ']') {
+      if (depth > 0) depth--;
+      expectKey = false;
+      keyValid = false;
+      pos++;
+      continue;
+    }
+
+    if (c == ',') {
+      expectKey = !stack[depth].isArray;
+      keyValid = false;
+      pos++;
+      continue;
+    }
+
+    if (c == '"') {
+      size_t start = ++pos;
+      while (pos < len && json[pos] != '"') {
+        if (json[pos] == '\\') pos++; // skip escaped char
+        pos++;
+      }
+      size_t end = pos < len ? pos : len;
+      pos++; // closing quote
+
+      if (expectKey) {
+        const Level& lvl = stack[depth];
+        keyValid = lvl.valid;
+        if (keyValid) {
+          uint32_t h = lvl.hash;
+          if (depth > 0) h = restHashStep(h, '.');
+          for (size_t i = start; i < end; i++) h = restHashStep(h, json[i]);
+          keyHash = h;
+        }
+        expectKey = false;
+      } else if (keyValid && !stack[depth].isArray) {
+        int idx = findField(fields, fieldCount, keyHash);
+        if (idx >= 0) {
+          storeValue(fields[idx], record, json + start, end - start, true);
+          found |= 1u << idx;
+        }
+        keyValid = false;
+      }
+      continue;
+    }
+
+    // Bare scalar: number, true, false or null
+    size_t start = pos;
+    while (pos < len && json[pos] != ',' && json[pos] != '}' && json[pos] != ']' &&
+           json[pos] != ' ' && json[pos] != '\r' && json[pos] != '\n' && json[pos] != '\t') {
+      pos++;
+    }
+    if (keyValid && !stack[depth].isArray && !(pos - start == 4 && memcmp(json + start, "null", 4) == 0)) {
+      int idx = findField(fields, fieldCount, keyHash);
+      if (idx >= 0) {
+        storeValue(fields[idx], record, json + start, pos - start, false);
+        found |= 1u << idx;
+      }
+    }
+    keyValid = false;
+  }
+
+  return found;
+}
+
+size_t restRecordToJson(const RestField* fields, uint8_t fieldCount, const void* record, char* buf, size_t cap) {
+  size_t n = 0;
+  if (cap < 3) return 0;
+  buf[n++] = '{';
+
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    const RestField& f = fields[i];
+    const uint8_t* src = (const uint8_t*)record + f.offset;
+
+    // Use the leaf of the dotted path as the key
+    const char* key = strrchr(f.path, '.');
+    key = key ? key + 1 : f.path;
+
+    int w = snprintf(buf + n, cap - n, "%s\"%s\":", i ? "," : "", key);
+    if (w < 0 || (size_t)w >= cap - n) return 0;
+    n += w;
+
+    switch (f.type) {
+      case REST_FLOAT: {
+        float x; memcpy(&x, src, sizeof(x));
+        w = snprintf(buf + n, cap - n, "%.6f", x);
+        break;
+      }
+      case REST_DOUBLE: {
+        double x; memcpy(&x, src, sizeof(x));
+        w = snprintf(buf + n, cap - n, "%.6f", x);
+        break;
+      }
+      case REST_INT: {
+        long long x = 0;
+        if (f.size == sizeof(int32_t)) { int32_t v; memcpy(&v, src, sizeof(v)); x = v; }
+        else { int64_t v; memcpy(&v, src, sizeof(v)); x = v; }
+        w = snprintf(buf + n, cap - n, "%lld", x);
+        break;
+      }
+      case REST_UINT: {
+        unsigned long long x = 0;
+        if (f.size == sizeof(uint32_t)) { uint32_t v; memcpy(&v, src, sizeof(v)); x = v; }
+        else { uint64_t v; memcpy(&v, src, sizeof(v)); x = v; }
+        w = snprintf(buf + n, cap - n, "%llu", x);
+        break;
+      }
+      case REST_BOOL: {
+        bool x; memcpy(&x, src, sizeof(x));
+        w = snprintf(buf + n, cap - n, "%s", x ? "true" : "false");
+        break;
+      }
+      case REST_STRING:
+        w = snprintf(buf + n, cap - n, "\"%s\"", (const char*)src);
+        break;
+    }
+    if (w < 0 || (size_t)w >= cap - n) return 0;
+    n += w;
+  }
+
+  if (n + 2 > cap) return 0;
+  buf[n++] = '}';
+  buf[n] = '\0';
+  return n;
+}
+
+uint32_t restBodyHash(const char* body, size_t len) {
+  uint32_t h = REST_HASH_BASIS;
+  for (size_t i = 0; i < len; i++) h = restHashStep(h, body[i]);
+  return h;
+}
+
+long restParseMaxAge(const char* cacheControl) {
+  if (cacheControl == nullptr || *cacheControl == '\0') return -1;
+
+  long maxAge = -1;
+  const char* p = cacheControl;
+  while (*p) {
+    while (*p == ' ' || *p == ',') p++;
+    if (strncasecmp(p, "no-cache", 8) == 0 || strncasecmp(p, "no-store", 8) == 0) {
+      return 0;
+    }
+    if (strncasecmp(p, "max-age=", 8) == 0) {
+      maxAge = strtol(p + 8, nullptr, 10);
+      if (maxAge < 0) maxAge = 0;
+    }
+    while (*p && *p != ',') p++;
+  }
+  return maxAge;
+}
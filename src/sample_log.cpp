@@ -0,0 +1,294 @@
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "sample_log.h"
+
+static const uint32_t SECTOR_SIZE = 4096;
+static const uint32_t HEADER_SIZE = 16;
+static const uint32_t RECORD_SIZE = sizeof(SampleLogRecord);
+static const uint16_t RECORDS_PER_SECTOR = (SECTOR_SIZE - HEADER_SIZE) / RECORD_SIZE; // 255
+static const uint32_t SECTOR_MAGIC = 0x474F4C53; // "SLOG"
+static const uint8_t RECORD_MARKER = 0xA5;
+static const uint32_t EMPTY_TS = 0xFFFFFFFF;
+
+struct SectorHeader {
+  uint32_t magic;
+  uint32_t seq;         // increases by one per sector written, never reused
+  uint16_t recordSize;
+  uint16_t version;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(SectorHeader) == HEADER_SIZE, "SectorHeader must fill the header slot");
+
+static const esp_partition_t* partition = nullptr;
+static uint16_t sectorCount = 0;
+
+// Sparse index, one entry per sector (0 = no valid header)
+static uint32_t* sectorSeq = nullptr;
+static uint32_t* sectorFirstTs = nullptr;
+
+static uint16_t headSector = 0;   // sector being written
+static uint16_t headRecord = 0;   // next free record in headSector
+static uint16_t usedSectors = 0;  // valid sectors, ending at headSector
+static uint32_t lastTs = 0;
+
+static SampleLogStats stats;
+
+// CRC-8, polynomial 0x07
+static uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+static bool recordValid(const SampleLogRecord& r) {
+  return r.timestamp != EMPTY_TS && r.marker == RECORD_MARKER &&
+         r.crc == crc8((const uint8_t*)&r, RECORD_SIZE - 1);
+}
+
+static size_t recordOffset(uint16_t sector, uint16_t record) {
+  return (size_t)sector * SECTOR_SIZE + HEADER_SIZE + (size_t)record * RECORD_SIZE;
+}
+
+static uint32_t readTimestamp(uint16_t sector, uint16_t record) {
+  uint32_t ts = EMPTY_TS;
+  esp_partition_read(partition, recordOffset(sector, record), &ts, sizeof(ts));
+  return ts;
+}
+
+static uint16_t oldestSector() {
+  return (uint16_t)((headSector + sectorCount - (usedSectors - 1)) % sectorCount);
+}
+
+// Records written so far in a sector of the ring
+static uint16_t sectorRecords(uint16_t sector) {
+  return sector == headSector ? headRecord : RECORDS_PER_SECTOR;
+}
+
+// Erase a sector and stamp it as the next one in the ring
+static bool openSector(uint16_t sector, uint32_t seq) {
+  sectorSeq[sector] = 0;
+  sectorFirstTs[sector] = EMPTY_TS;
+  if (esp_partition_erase_range(partition, (size_t)sector * SECTOR_SIZE, SECTOR_SIZE) != ESP_OK) {
+    return false;
+  }
+  stats.erases++;
+
+  SectorHeader h = {SECTOR_MAGIC, seq, (uint16_t)RECORD_SIZE, 1, 0xFFFFFFFF};
+  if (esp_partition_write(partition, (size_t)sector * SECTOR_SIZE, &h, sizeof(h)) != ESP_OK) {
+    return false;
+  }
+  sectorSeq[sector] = seq;
+  return true;
+}
+
+static void refreshStats() {
+  stats.sectorsUsed = usedSectors;
+  stats.records = usedSectors ? (uint32_t)(usedSectors - 1) * RECORDS_PER_SECTOR + headRecord : 0;
+  stats.newestTs = lastTs;
+  stats.oldestTs = 0;
+  if (usedSectors) {
+    uint32_t first = sectorFirstTs[oldestSector()];
+    stats.oldestTs = first == EMPTY_TS ? 0 : first;
+  }
+}
+
+bool sampleLogBegin(const char* label) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (partition == nullptr) {
+    Serial.printf("[LOG] No '%s' partition, sample log disabled\n", label);
+    return false;
+  }
+
+  uint32_t sectors = partition->size / SECTOR_SIZE;
+  sectorCount = (uint16_t)(sectors > 0xFFFF ? 0xFFFF : sectors);
+  sectorSeq = (uint32_t*)calloc(sectorCount, sizeof(uint32_t));
+  sectorFirstTs = (uint32_t*)malloc(sectorCount * sizeof(uint32_t));
+  if (sectorCount < 2 || sectorSeq == nullptr || sectorFirstTs == nullptr) {
+    Serial.println("[LOG] Sample log partition too small or out of memory");
+    partition = nullptr;
+    return false;
+  }
+
+  // Rebuild the sparse index from the sector headers
+  uint32_t headSeq = 0;
+  for (uint16_t s = 0; s < sectorCount; s++) {
+    SectorHeader h;
+    sectorFirstTs[s] = EMPTY_TS;
+    if (esp_partition_read(partition, (size_t)s * SECTOR_SIZE, &h, sizeof(h)) != ESP_OK) continue;
+    if (h.magic != SECTOR_MAGIC || h.recordSize != RECORD_SIZE || h.seq == 0 || h.seq == 0xFFFFFFFF) continue;
+    sectorSeq[s] = h.seq;
+    sectorFirstTs[s] = readTimestamp(s, 0);
+    if (h.seq > headSeq) {
+      headSeq = h.seq;
+      headSector = s;
+    }
+  }
+
+  if (headSeq == 0) {
+    Serial.println("[LOG] Formatting sample log partition");
+    headSector = 0;
+    headRecord = 0;
+    usedSectors = 1;
+    if (!openSector(0, 1)) {
+      Serial.println("[LOG] Format failed, sample log disabled");
+      partition = nullptr;
+      return false;
+    }
+  } else {
+    // Records are written in order, so erased slots are a suffix of the sector
+    uint16_t lo = 0, hi = RECORDS_PER_SECTOR;
+    while (lo < hi) {
+      uint16_t mid = (lo + hi) / 2;
+      if (readTimestamp(headSector, mid) == EMPTY_TS) hi = mid;
+      else lo = mid + 1;
+    }
+    headRecord = lo;
+
+    // Walk back while the sequence numbers are contiguous
+    usedSectors = 1;
+    while (usedSectors < sectorCount) {
+      uint16_t prev = (uint16_t)((headSector + sectorCount - usedSectors) % sectorCount);
+      if (sectorSeq[prev] != headSeq - usedSectors) break;
+      usedSectors++;
+    }
+
+    // Newest timestamp: last record written, possibly in the previous sector
+    if (headRecord > 0) {
+      lastTs = readTimestamp(headSector, headRecord - 1);
+    } else if (usedSectors > 1) {
+      lastTs = readTimestamp((uint16_t)((headSector + sectorCount - 1) % sectorCount), RECORDS_PER_SECTOR - 1);
+    }
+    if (lastTs == EMPTY_TS) lastTs = 0;
+  }
+
+  stats.sectors = sectorCount;
+  stats.capacity = (uint32_t)sectorCount * RECORDS_PER_SECTOR;
+  refreshStats();
+  Serial.printf("[LOG] %u/%u sectors used, %lu records (%lu..%lu)\n",
+                usedSectors, sectorCount, (unsigned long)stats.records,
+                (unsigned long)stats.oldestTs, (unsigned long)stats.newestTs);
+  return true;
+}
+
+bool sampleLogAppend(const CoordSample& sample, uint32_t rxDelayMs) {
+  if (partition == nullptr || sample.timestamp == EMPTY_TS || sample.timestamp <= lastTs) return false;
+
+  if (headRecord >= RECORDS_PER_SECTOR) {
+    // Recycle the oldest sector when the ring is full
+    uint16_t next = (uint16_t)((headSector + 1) % sectorCount);
+    if (usedSectors == sectorCount) usedSectors--;
+    if (!openSector(next, sectorSeq[headSector] + 1)) {
+      stats.appendErrors++;
+      return false;
+    }
+    headSector = next;
+    headRecord = 0;
+    usedSectors++;
+  }
+
+  SampleLogRecord r;
+  r.timestamp = sample.timestamp;
+  r.latE4 = sample.latE4;
+  r.lonE4 = sample.lonE4;
+  r.rxDelayMs = (uint16_t)(rxDelayMs > 0xFFFF ? 0xFFFF : rxDelayMs);
+  r.marker = RECORD_MARKER;
+  r.crc = crc8((const uint8_t*)&r, RECORD_SIZE - 1);
+
+  // A slot is never rewritten without an erase, so a failed write still uses it
+  esp_err_t err = esp_partition_write(partition, recordOffset(headSector, headRecord), &r, sizeof(r));
+  if (headRecord == 0) sectorFirstTs[headSector] = r.timestamp;
+  headRecord++;
+  if (err != ESP_OK) {
+    stats.appendErrors++;
+    return false;
+  }
+
+  lastTs = r.timestamp;
+  stats.appends++;
+  refreshStats();
+  return true;
+}
+
+bool sampleLogSeek(uint32_t fromTs, uint32_t toTs, SampleLogCursor* cursor) {
+  cursor->done = true;
+  if (partition == nullptr || fromTs > toTs || stats.records == 0) return false;
+
+  // Last sector whose first timestamp is <= fromTs (logical order, oldest first)
+  uint16_t oldest = oldestSector();
+  uint16_t lo = 0, hi = usedSectors;
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    uint32_t first = sectorFirstTs[(oldest + mid) % sectorCount];
+    if (first != EMPTY_TS && first <= fromTs) lo = mid + 1;
+    else hi = mid;
+  }
+  uint16_t sector = (uint16_t)((oldest + (lo ? lo - 1 : 0)) % sectorCount);
+
+  // First record >= fromTs inside that sector
+  uint16_t rlo = 0, rhi = sectorRecords(sector);
+  while (rlo < rhi) {
+    uint16_t mid = (rlo + rhi) / 2;
+    if (readTimestamp(sector, mid) < fromTs) rlo = mid + 1;
+    else rhi = mid;
+  }
+
+  cursor->sector = sector;
+  cursor->record = rlo;
+  cursor->seq = sectorSeq[sector];
+  cursor->toTs = toTs;
+  cursor->done = false;
+  return true;
+}
+
+size_t sampleLogRead(SampleLogCursor* cursor, SampleLogRecord* out, size_t max) {
+  size_t n = 0;
+  while (n < max && !cursor->done && partition != nullptr) {
+    // The sector was recycled under the cursor
+    if (sectorSeq[cursor->sector] != cursor->seq) {
+      cursor->done = true;
+      break;
+    }
+
+    uint16_t limit = sectorRecords(cursor->sector);
+    if (cursor->record >= limit) {
+      if (cursor->sector == headSector) {
+        cursor->done = true;
+        break;
+      }
+      cursor->sector = (uint16_t)((cursor->sector + 1) % sectorCount);
+      cursor->record = 0;
+      cursor->seq++;
+      continue;
+    }
+
+    // One flash read for the whole batch, then drop torn or corrupt records
+    size_t batch = limit - cursor->record;
+    if (batch > max - n) batch = max - n;
+    if (esp_partition_read(partition, recordOffset(cursor->sector, cursor->record),
+                           out + n, batch * RECORD_SIZE) != ESP_OK) {
+      cursor->done = true;
+      break;
+    }
+    cursor->record += batch;
+
+    size_t base = n;
+    for (size_t i = 0; i < batch; i++) {
+      SampleLogRecord r = out[base + i];
+      if (!recordValid(r)) continue;
+      if (r.timestamp > cursor->toTs) {
+        cursor->done = true;
+        break;
+      }
+      out[n++] = r;
+    }
+  }
+  return n;
+}
+
+const SampleLogStats& sampleLogStats() {
+  return stats;
+}
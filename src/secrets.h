@@ -4,7 +4,20 @@
 // MQTT configuration - replace with your broker details
 #define MQTT_SERVER "maisonneuve.aws.thinger.io"
 #define MQTT_PORT 1883
+#define MQTT_USE_TLS 0 // 1 = TLS to the broker (set MQTT_PORT to 8883), needs TLS_CA_CERT
 #define MQTT_USER "owen2"
 #define MQTT_PASSWORD "Certif24@"
 #define MQTT_TOPIC_COORDS "cm/2288053/coordonnees"
+#define MQTT_TOPIC_HISTORY "cm/2288053/historique" // binary coord_codec batches
+#define MQTT_TOPIC_HISTORY_QUERY "cm/2288053/requete" // "<from> <to>" Unix seconds
+#define MQTT_TOPIC_HISTORY_REPLY "cm/2288053/reponse" // coord_codec chunks from the flash log
+#define MQTT_TOPIC_ASTROS "cm/2288053/astronautes"
+#define MQTT_TOPIC_DISTANCE "cm/2288053/distance"
+#define MQTT_TOPIC_CMD "cm/2288053/cmd"       // parameters at cmd/<name> = value, cmd/reset restores defaults
+#define MQTT_TOPIC_STATUS "cm/2288053/etat"    // command acks
+#define MQTT_TOPIC_GATEWAY "cm/2288053/passerelle" // gateway ESP-NOW batches
+
+// PEM CA chain used for every TLS connection (https:// endpoints and MQTT_USE_TLS)
+#define TLS_CA_CERT ""
+
 //(client.connect("esp2Ow", "owen2", "Certif24@"))
\ No newline at end of file
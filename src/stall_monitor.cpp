@@ -0,0 +1,182 @@
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include "stall_monitor.h"
+#include "http_async.h"
+
+// REST and HTTP wait for one http_async batch, bounded by its deadline, then parse
+static const uint32_t HTTP_STAGE_BUDGET_MS = HTTP_ASYNC_BATCH_MS + 2000;
+static const uint32_t WIFI_STAGE_BUDGET_MS = 25000; // connectToNetwork() waits up to 20 s
+
+// The watchdog is fed between stages: it must outlast the longest one
+static_assert(HTTP_STAGE_BUDGET_MS < STALL_WATCHDOG_TIMEOUT_S * 1000, "watchdog shorter than an HTTP batch");
+static_assert(WIFI_STAGE_BUDGET_MS < STALL_WATCHDOG_TIMEOUT_S * 1000, "watchdog shorter than a Wi-Fi connect");
+
+// Per-stage budgets in ms, indexed by StallStage
+static const uint32_t stageBudgetMs[STAGE_COUNT] = {
+  0,                    // NONE
+  WIFI_STAGE_BUDGET_MS, // WIFI
+  10000,                // MQTT
+  HTTP_STAGE_BUDGET_MS, // REST
+  50,                   // RANGER
+  500,                  // ESPNOW
+  3500,                 // DNS: two 1.5 s queries
+  2000,                 // PUBLISH
+  HTTP_STAGE_BUDGET_MS, // HTTP
+};
+
+static const uint32_t RTC_MAGIC = 0x5354414C; // "STAL"
+
+struct StallRtcLog {
+  uint32_t magic;
+  uint16_t bootCount;
+  uint8_t head;
+  uint8_t count;
+  StallRecord records[STALL_LOG_SIZE];
+  uint8_t activeStage;       // stage running right now, STAGE_NONE between stages
+  uint32_t activeStartUptimeMs;
+};
+
+// Survives software and watchdog resets, garbage after power-on
+RTC_NOINIT_ATTR static StallRtcLog rtcLog;
+
+static bool started = false; // rtcLog is garbage until stallMonitorBegin() checked it
+static StallStage currentStage = STAGE_NONE;
+static unsigned long stageStartMillis = 0;
+static bool reportPending = false;
+static esp_reset_reason_t resetReason = ESP_RST_UNKNOWN;
+
+static void appendRecord(uint8_t stage, bool watchdog, uint32_t elapsedMs, uint32_t uptimeS) {
+  StallRecord& r = rtcLog.records[rtcLog.head];
+  r.stage = stage;
+  r.watchdog = watchdog ? 1 : 0;
+  r.boot = rtcLog.bootCount;
+  r.elapsedMs = elapsedMs;
+  r.uptimeS = uptimeS;
+  rtcLog.head = (rtcLog.head + 1) % STALL_LOG_SIZE;
+  if (rtcLog.count < STALL_LOG_SIZE) rtcLog.count++;
+}
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON: return "POWERON";
+    case ESP_RST_SW: return "SW";
+    case ESP_RST_PANIC: return "PANIC";
+    case ESP_RST_INT_WDT: return "INT_WDT";
+    case ESP_RST_TASK_WDT: return "TASK_WDT";
+    case ESP_RST_WDT: return "WDT";
+    case ESP_RST_BROWNOUT: return "BROWNOUT";
+    case ESP_RST_DEEPSLEEP: return "DEEPSLEEP";
+    default: return "OTHER";
+  }
+}
+
+void stallMonitorBegin() {
+  resetReason = esp_reset_reason();
+
+  bool valid = rtcLog.magic == RTC_MAGIC && rtcLog.head < STALL_LOG_SIZE &&
+               rtcLog.count <= STALL_LOG_SIZE && rtcLog.activeStage < STAGE_COUNT;
+  if (!valid || resetReason == ESP_RST_POWERON) {
+    memset(&rtcLog, 0, sizeof(rtcLog));
+    rtcLog.magic = RTC_MAGIC;
+  } else if (rtcLog.activeStage != STAGE_NONE) {
+    // The previous boot died inside a stage (watchdog, panic, ...)
+    Serial.printf("[STALL] Previous boot reset (%s) inside stage '%s'\n",
+                  resetReasonName(resetReason), stallStageName(rtcLog.activeStage));
+    appendRecord(rtcLog.activeStage, true, 0, rtcLog.activeStartUptimeMs / 1000);
+  }
+  rtcLog.activeStage = STAGE_NONE;
+  rtcLog.bootCount++;
+  started = true;
+  reportPending = rtcLog.count > 0 || resetReason != ESP_RST_POWERON;
+
+  // Reconfigure the task watchdog and watch the loop task (IDF 4.4 updates
+  // the timeout when already initialized)
+  esp_task_wdt_init(STALL_WATCHDOG_TIMEOUT_S, true);
+  esp_task_wdt_add(nullptr);
+
+  Serial.printf("[STALL] Boot #%u, reset reason %s, %u stall record(s) in RTC\n",
+                rtcLog.bootCount, resetReasonName(resetReason), rtcLog.count);
+}
+
+void stallLoopTick() {
+  esp_task_wdt_reset();
+}
+
+StallOuter stallStageBegin(StallStage stage) {
+  StallOuter outer = {currentStage, stageStartMillis};
+  if (!started) return outer;
+  esp_task_wdt_reset();
+  currentStage = stage;
+  stageStartMillis = millis();
+  rtcLog.activeStage = stage;
+  rtcLog.activeStartUptimeMs = stageStartMillis;
+  return outer;
+}
+
+void stallStageEnd(const StallOuter& outer) {
+  if (!started) return;
+  esp_task_wdt_reset();
+  uint32_t elapsed = millis() - stageStartMillis;
+  StallStage stage = currentStage;
+
+  // Resume the outer stage, minus the time spent in this one
+  currentStage = (StallStage)outer.stage;
+  stageStartMillis = outer.startMillis + elapsed;
+  rtcLog.activeStage = currentStage;
+  rtcLog.activeStartUptimeMs = stageStartMillis;
+
+  if (stage != STAGE_NONE && elapsed > stageBudgetMs[stage]) {
+    appendRecord(stage, false, elapsed, millis() / 1000);
+    Serial.printf("[STALL] Stage '%s' took %lu ms (budget %lu ms)\n",
+                  stallStageName(stage), (unsigned long)elapsed, (unsigned long)stageBudgetMs[stage]);
+  }
+}
+
+const char* stallStageName(uint8_t stage) {
+  switch (stage) {
+    case STAGE_WIFI: return "wifi";
+    case STAGE_MQTT: return "mqtt";
+    case STAGE_REST: return "rest";
+    case STAGE_RANGER: return "ranger";
+    case STAGE_ESPNOW: return "espnow";
+    case STAGE_DNS: return "dns";
+    case STAGE_PUBLISH: return "publish";
+    case STAGE_HTTP: return "http";
+    default: return "none";
+  }
+}
+
+bool stallReportPending() {
+  return reportPending;
+}
+
+void stallReportDone() {
+  reportPending = false;
+  rtcLog.head = 0;
+  rtcLog.count = 0;
+}
+
+size_t stallFormatReport(char* buf, size_t cap) {
+  int n = snprintf(buf, cap, "{\"boot\":%u,\"reset\":\"%s\",\"stalls\":[",
+                   rtcLog.bootCount, resetReasonName(resetReason));
+  if (n < 0 || (size_t)n >= cap) return 0;
+
+  // Oldest first
+  for (uint8_t i = 0; i < rtcLog.count; i++) {
+    uint8_t idx = (rtcLog.head + STALL_LOG_SIZE - rtcLog.count + i) % STALL_LOG_SIZE;
+    const StallRecord& r = rtcLog.records[idx];
+    int w = snprintf(buf + n, cap - n, "%s{\"stage\":\"%s\",\"ms\":%lu,\"wdt\":%u,\"boot\":%u,\"uptime_s\":%lu}",
+                     i ? "," : "", stallStageName(r.stage), (unsigned long)r.elapsedMs,
+                     r.watchdog, r.boot, (unsigned long)r.uptimeS);
+    if (w < 0 || (size_t)(n + w) >= cap) break; // keep what fits
+    n += w;
+  }
+
+  if ((size_t)n + 3 > cap) return 0;
+  buf[n++] = ']';
+  buf[n++] = '}';
+  buf[n] = '\0';
+  return n;
+}
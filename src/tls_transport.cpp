@@ -0,0 +1,385 @@
+#include <Arduino.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/error.h>
+#include <mbedtls/x509_crt.h>
+#include "secrets.h"
+#include "tls_transport.h"
+
+#ifndef TLS_CA_CERT
+#define TLS_CA_CERT ""
+#endif
+
+// ========== Shared TLS state (parsed / seeded once) ==========
+
+static bool sharedReady = false;
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctrDrbg;
+static mbedtls_x509_crt caChain;
+static mbedtls_ssl_config sslConfig;
+
+static TlsStats stats = {};
+// Counters are updated from the MQTT task and every HTTP worker
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Last session per host:port, offered again on reconnect
+struct SessionEntry {
+  char host[64];
+  uint16_t port;
+  bool valid;
+  mbedtls_ssl_session session;
+};
+static const uint8_t SESSION_CACHE_SIZE = 4;
+static SessionEntry sessionCache[SESSION_CACHE_SIZE];
+static uint8_t sessionCacheNext = 0;
+
+// Handshakes run concurrently from the HTTP workers and the MQTT network
+// task. Only the shared setup, session cache and RNG are locked, each for a
+// few microseconds, never the network round trips.
+static StaticSemaphore_t sharedLockBuffer;
+static SemaphoreHandle_t sharedLock = nullptr;
+static portMUX_TYPE sharedLockInitMux = portMUX_INITIALIZER_UNLOCKED;
+
+struct SharedLock {
+  SharedLock() {
+    portENTER_CRITICAL(&sharedLockInitMux);
+    if (sharedLock == nullptr) sharedLock = xSemaphoreCreateMutexStatic(&sharedLockBuffer);
+    portEXIT_CRITICAL(&sharedLockInitMux);
+    xSemaphoreTake(sharedLock, portMAX_DELAY);
+  }
+  ~SharedLock() { xSemaphoreGive(sharedLock); }
+};
+
+// ctr_drbg is not thread-safe without MBEDTLS_THREADING_C
+static int lockedRandom(void* ctx, unsigned char* out, size_t len) {
+  SharedLock guard;
+  return mbedtls_ctr_drbg_random(ctx, out, len);
+}
+
+static void printTlsError(const char* what, int ret) {
+  char buf[96];
+  mbedtls_strerror(ret, buf, sizeof(buf));
+  Serial.printf("[TLS] %s failed: -0x%04x (%s)\n", what, -ret, buf);
+}
+
+static bool initShared() {
+  if (sharedReady) return true;
+
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&ctrDrbg);
+  mbedtls_x509_crt_init(&caChain);
+  mbedtls_ssl_config_init(&sslConfig);
+  for (uint8_t i = 0; i < SESSION_CACHE_SIZE; i++) {
+    mbedtls_ssl_session_init(&sessionCache[i].session);
+  }
+
+  int ret = mbedtls_ctr_drbg_seed(&ctrDrbg, mbedtls_entropy_func, &entropy, nullptr, 0);
+  if (ret != 0) {
+    printTlsError("RNG seed", ret);
+    return false;
+  }
+
+  // Parse the CA chain once instead of on every connect
+  const char* ca = TLS_CA_CERT;
+  if (ca[0] == '\0') {
+    Serial.println("[TLS] TLS_CA_CERT is empty in secrets.h, refusing TLS connections");
+    return false;
+  }
+  ret = mbedtls_x509_crt_parse(&caChain, (const unsigned char*)ca, strlen(ca) + 1);
+  if (ret != 0) {
+    printTlsError("CA parse", ret);
+    return false;
+  }
+
+  ret = mbedtls_ssl_config_defaults(&sslConfig, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  if (ret != 0) {
+    printTlsError("SSL config", ret);
+    return false;
+  }
+  mbedtls_ssl_conf_authmode(&sslConfig, MBEDTLS_SSL_VERIFY_REQUIRED);
+  mbedtls_ssl_conf_ca_chain(&sslConfig, &caChain, nullptr);
+  mbedtls_ssl_conf_rng(&sslConfig, lockedRandom, &ctrDrbg);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&sslConfig, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+  sharedReady = true;
+  Serial.println("[TLS] Shared CA chain and config ready");
+  return true;
+}
+
+static SessionEntry* findSession(const char* host, uint16_t port, bool create) {
+  for (uint8_t i = 0; i < SESSION_CACHE_SIZE; i++) {
+    SessionEntry& e = sessionCache[i];
+    if (e.port == port && strncmp(e.host, host, sizeof(e.host)) == 0) return &e;
+  }
+  if (!create) return nullptr;
+
+  // Round-robin eviction, the cache is tiny
+  SessionEntry& e = sessionCache[sessionCacheNext];
+  sessionCacheNext = (sessionCacheNext + 1) % SESSION_CACHE_SIZE;
+  mbedtls_ssl_session_free(&e.session);
+  mbedtls_ssl_session_init(&e.session);
+  strlcpy(e.host, host, sizeof(e.host));
+  e.port = port;
+  e.valid = false;
+  return &e;
+}
+
+TlsStats tlsStats() {
+  portENTER_CRITICAL(&statsMux);
+  TlsStats copy = stats;
+  portEXIT_CRITICAL(&statsMux);
+  return copy;
+}
+
+static void countFailedHandshake() {
+  portENTER_CRITICAL(&statsMux);
+  stats.failedHandshakes++;
+  portEXIT_CRITICAL(&statsMux);
+}
+
+void tlsNoteReusedConnection() {
+  portENTER_CRITICAL(&statsMux);
+  stats.reusedConnections++;
+  portEXIT_CRITICAL(&statsMux);
+}
+
+// ========== TlsTransport ==========
+
+TlsTransport::TlsTransport() : sslActive(false), peekByte(-1), handshakeTimeoutMs(10000) {
+  mbedtls_ssl_init(&ssl);
+}
+
+TlsTransport::~TlsTransport() {
+  stop();
+}
+
+// Non-blocking BIO over the plain WiFiClient
+int TlsTransport::bioSend(void* ctx, const unsigned char* buf, size_t len) {
+  WiFiClient* tcp = (WiFiClient*)ctx;
+  if (!tcp->connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+  size_t n = tcp->write(buf, len);
+  return n > 0 ? (int)n : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+int TlsTransport::bioRecv(void* ctx, unsigned char* buf, size_t len) {
+  WiFiClient* tcp = (WiFiClient*)ctx;
+  int avail = tcp->available();
+  if (avail <= 0) {
+    return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+  }
+  int n = tcp->read(buf, len < (size_t)avail ? len : (size_t)avail);
+  return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+bool TlsTransport::handshake(const char* host, uint16_t port, uint32_t timeoutMs) {
+  {
+    SharedLock guard;
+    if (!initShared()) return false;
+  }
+
+  mbedtls_ssl_free(&ssl);
+  mbedtls_ssl_init(&ssl);
+  int ret = mbedtls_ssl_setup(&ssl, &sslConfig);
+  if (ret != 0) {
+    printTlsError("SSL setup", ret);
+    return false;
+  }
+  mbedtls_ssl_set_hostname(&ssl, host);
+  mbedtls_ssl_set_bio(&ssl, &tcp, bioSend, bioRecv, nullptr);
+
+  // Offer the cached session; the server decides whether to resume.
+  // set_session copies it, so the entry is free for other handshakes.
+  bool offered;
+  {
+    SharedLock guard;
+    SessionEntry* entry = findSession(host, port, false);
+    offered = entry != nullptr && entry->valid && mbedtls_ssl_set_session(&ssl, &entry->session) == 0;
+  }
+
+  // Stepped rather than mbedtls_ssl_handshake() to see the session ID that
+  // ClientHello actually carries: with a ticket, mbedtls replaces the cached
+  // ID with fresh random bytes (RFC 5077 3.4), and a resuming server echoes
+  // those, not the cached ones
+  uint8_t offeredId[32];
+  size_t offeredIdLen = 0;
+  bool helloWritten = false;
+  unsigned long start = millis();
+  while (ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+    ret = mbedtls_ssl_handshake_step(&ssl);
+    if (!helloWritten && ssl.state > MBEDTLS_SSL_CLIENT_HELLO) {
+      helloWritten = true;
+      if (offered) {
+        offeredIdLen = ssl.session_negotiate->id_len;
+        memcpy(offeredId, ssl.session_negotiate->id, offeredIdLen);
+      }
+    }
+    if (ret == 0) continue;
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      printTlsError("Handshake", ret);
+      if (offered) {
+        // Don't keep offering a session the server rejects
+        SharedLock guard;
+        SessionEntry* entry = findSession(host, port, false);
+        if (entry != nullptr) entry->valid = false;
+      }
+      countFailedHandshake();
+      return false;
+    }
+    if (millis() - start > timeoutMs) {
+      Serial.println("[TLS] Handshake timeout");
+      countFailedHandshake();
+      return false;
+    }
+    delay(1);
+  }
+  uint32_t elapsed = millis() - start;
+
+  // RFC 5246 / 5077: a resuming server echoes the session ID we sent
+  const mbedtls_ssl_session* negotiated = mbedtls_ssl_get_session_pointer(&ssl);
+  bool resumed = offeredIdLen > 0 && negotiated->id_len == offeredIdLen &&
+                 memcmp(negotiated->id, offeredId, offeredIdLen) == 0;
+  portENTER_CRITICAL(&statsMux);
+  stats.lastHandshakeMs = elapsed;
+  if (resumed) {
+    stats.resumedHandshakes++;
+    stats.resumedHandshakeMsTotal += elapsed;
+  } else {
+    stats.fullHandshakes++;
+    stats.fullHandshakeMsTotal += elapsed;
+  }
+  portEXIT_CRITICAL(&statsMux);
+
+  // Save the (possibly new) session for the next reconnect
+  {
+    SharedLock guard;
+    SessionEntry* entry = findSession(host, port, true);
+    mbedtls_ssl_session_free(&entry->session);
+    mbedtls_ssl_session_init(&entry->session);
+    entry->valid = mbedtls_ssl_get_session(&ssl, &entry->session) == 0;
+  }
+
+  Serial.printf("[TLS] %s:%u %s handshake in %lu ms\n", host, port, resumed ? "resumed" : "full", (unsigned long)elapsed);
+  return true;
+}
+
+int TlsTransport::connect(const char* host, uint16_t port, int32_t timeout) {
+  stop();
+  // timeout covers DNS, TCP and the handshake together
+  unsigned long start = millis();
+  uint32_t budgetMs = timeout > 0 ? (uint32_t)timeout : handshakeTimeoutMs;
+  if (!tcp.connect(host, port, (int32_t)budgetMs)) {
+    Serial.printf("[TLS] TCP connect to %s:%u failed\n", host, port);
+    return 0;
+  }
+  uint32_t spent = millis() - start;
+  uint32_t left = spent < budgetMs ? budgetMs - spent : 0;
+  if (left == 0 || !handshake(host, port, left < handshakeTimeoutMs ? left : handshakeTimeoutMs)) {
+    tcp.stop();
+    return 0;
+  }
+  sslActive = true;
+  return 1;
+}
+
+int TlsTransport::connect(const char* host, uint16_t port) {
+  return connect(host, port, (int32_t)handshakeTimeoutMs);
+}
+
+int TlsTransport::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+  // No hostname: no SNI, sessions cached under the dotted address
+  return connect(ip.toString().c_str(), port, timeout);
+}
+
+int TlsTransport::connect(IPAddress ip, uint16_t port) {
+  return connect(ip, port, (int32_t)handshakeTimeoutMs);
+}
+
+size_t TlsTransport::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t TlsTransport::write(const uint8_t* buf, size_t size) {
+  if (!sslActive) return 0;
+  size_t written = 0;
+  unsigned long start = millis();
+  while (written < size) {
+    int ret = mbedtls_ssl_write(&ssl, buf + written, size - written);
+    if (ret > 0) {
+      written += ret;
+    } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      printTlsError("Write", ret);
+      stop();
+      break;
+    } else if (millis() - start > handshakeTimeoutMs) {
+      break;
+    } else {
+      delay(1);
+    }
+  }
+  return written;
+}
+
+int TlsTransport::available() {
+  if (!sslActive) return 0;
+  int pending = (peekByte >= 0) ? 1 : 0;
+  if (mbedtls_ssl_get_bytes_avail(&ssl) == 0 && tcp.available() > 0) {
+    // Zero-length read processes buffered records without consuming data
+    int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) printTlsError("Read", ret);
+      stop();
+      return pending;
+    }
+  }
+  return pending + (int)mbedtls_ssl_get_bytes_avail(&ssl);
+}
+
+int TlsTransport::read(uint8_t* buf, size_t size) {
+  if (!sslActive || size == 0) return -1;
+  size_t n = 0;
+  if (peekByte >= 0) {
+    buf[n++] = (uint8_t)peekByte;
+    peekByte = -1;
+    if (n == size) return n;
+  }
+  if (available() <= 0) return n > 0 ? (int)n : -1;
+  int ret = mbedtls_ssl_read(&ssl, buf + n, size - n);
+  if (ret > 0) return n + ret;
+  if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) stop();
+  return n > 0 ? (int)n : -1;
+}
+
+int TlsTransport::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsTransport::peek() {
+  if (peekByte < 0) {
+    uint8_t b;
+    if (read(&b, 1) == 1) peekByte = b;
+  }
+  return peekByte;
+}
+
+void TlsTransport::flush() {
+  tcp.flush();
+}
+
+void TlsTransport::stop() {
+  if (sslActive) {
+    mbedtls_ssl_close_notify(&ssl);
+    sslActive = false;
+  }
+  mbedtls_ssl_free(&ssl);
+  mbedtls_ssl_init(&ssl);
+  peekByte = -1;
+  tcp.stop();
+}
+
+uint8_t TlsTransport::connected() {
+  if (!sslActive) return 0;
+  return tcp.connected() || peekByte >= 0 || mbedtls_ssl_get_bytes_avail(&ssl) > 0;
+}
@@ -0,0 +1,149 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "transport_pool.h"
+#include "tls_transport.h"
+#include "dns_cache.h"
+
+struct PoolEntry {
+  char host[64];
+  uint16_t port;
+  bool secure;
+  bool inUse;
+  unsigned long lastUsedMillis;
+  WiFiClient* client;
+};
+
+static PoolEntry pool[TRANSPORT_POOL_SIZE];
+
+// slots: one count per entry not checked out; lock: guards the table
+static StaticSemaphore_t slotsBuffer;
+static SemaphoreHandle_t slots = nullptr;
+static StaticSemaphore_t lockBuffer;
+static SemaphoreHandle_t lock = nullptr;
+static portMUX_TYPE initMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void poolInit() {
+  portENTER_CRITICAL(&initMux);
+  if (lock == nullptr) {
+    lock = xSemaphoreCreateMutexStatic(&lockBuffer);
+    slots = xSemaphoreCreateCountingStatic(TRANSPORT_POOL_SIZE, TRANSPORT_POOL_SIZE, &slotsBuffer);
+  }
+  portEXIT_CRITICAL(&initMux);
+}
+
+static void closeEntry(PoolEntry& e) {
+  e.client->stop();
+  delete e.client;
+  e.client = nullptr;
+}
+
+bool transportParseUrl(const char* url, bool* secure, char* host, size_t hostCap, uint16_t* port) {
+  const char* p;
+  if (strncmp(url, "https://", 8) == 0) {
+    *secure = true;
+    *port = 443;
+    p = url + 8;
+  } else if (strncmp(url, "http://", 7) == 0) {
+    *secure = false;
+    *port = 80;
+    p = url + 7;
+  } else {
+    return false;
+  }
+
+  size_t len = strcspn(p, ":/?");
+  if (len == 0 || len >= hostCap) return false;
+  memcpy(host, p, len);
+  host[len] = '\0';
+
+  if (p[len] == ':') {
+    long explicitPort = strtol(p + len + 1, nullptr, 10);
+    if (explicitPort <= 0 || explicitPort > 65535) return false;
+    *port = (uint16_t)explicitPort;
+  }
+  return true;
+}
+
+WiFiClient* transportAcquire(const char* url, uint32_t waitMs) {
+  bool secure;
+  char host[64];
+  uint16_t port;
+  if (!transportParseUrl(url, &secure, host, sizeof(host), &port)) {
+    Serial.print("[NET] Cannot parse URL: "); Serial.println(url);
+    return nullptr;
+  }
+
+  poolInit();
+  if (xSemaphoreTake(slots, pdMS_TO_TICKS(waitMs)) != pdTRUE) {
+    Serial.println("[NET] Transport pool exhausted");
+    return nullptr;
+  }
+
+  // A slot is reserved, so at least one entry is free or idle
+  xSemaphoreTake(lock, portMAX_DELAY);
+  PoolEntry* chosen = nullptr;
+  PoolEntry* freeEntry = nullptr;
+  PoolEntry* oldestIdle = nullptr;
+  for (uint8_t i = 0; i < TRANSPORT_POOL_SIZE; i++) {
+    PoolEntry& e = pool[i];
+    if (e.client == nullptr) {
+      if (freeEntry == nullptr) freeEntry = &e;
+    } else if (!e.inUse) {
+      if (e.port == port && e.secure == secure && strcmp(e.host, host) == 0) {
+        // Prefer a connection that is still open
+        if (chosen == nullptr || (!chosen->client->connected() && e.client->connected())) chosen = &e;
+      } else if (oldestIdle == nullptr || (long)(e.lastUsedMillis - oldestIdle->lastUsedMillis) < 0) {
+        oldestIdle = &e;
+      }
+    }
+  }
+
+  if (chosen != nullptr) {
+    if (chosen->client->connected() && secure) tlsNoteReusedConnection();
+  } else {
+    chosen = freeEntry;
+    if (chosen == nullptr) {
+      // Pool full of other hosts: close the least recently used idle one
+      chosen = oldestIdle;
+      closeEntry(*chosen);
+    }
+    strlcpy(chosen->host, host, sizeof(chosen->host));
+    chosen->port = port;
+    chosen->secure = secure;
+    chosen->client = secure ? (WiFiClient*)new TlsTransport() : (WiFiClient*)new DnsCachedClient();
+  }
+  chosen->inUse = true;
+  WiFiClient* client = chosen->client;
+  xSemaphoreGive(lock);
+  return client;
+}
+
+void transportRelease(WiFiClient* client) {
+  if (client == nullptr) return;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  PoolEntry* released = nullptr;
+  for (uint8_t i = 0; i < TRANSPORT_POOL_SIZE; i++) {
+    PoolEntry& e = pool[i];
+    if (e.client == client && e.inUse) {
+      e.inUse = false;
+      e.lastUsedMillis = millis();
+      released = &e;
+      break;
+    }
+  }
+
+  // One idle connection per host is enough between batches: each TLS one
+  // holds ~16 KB of record buffers, so close the older duplicates
+  if (released != nullptr) {
+    for (uint8_t i = 0; i < TRANSPORT_POOL_SIZE; i++) {
+      PoolEntry& e = pool[i];
+      if (&e == released || e.client == nullptr || e.inUse) continue;
+      if (e.port == released->port && e.secure == released->secure && strcmp(e.host, released->host) == 0) {
+        closeEntry(e);
+      }
+    }
+    xSemaphoreGive(slots);
+  }
+  xSemaphoreGive(lock);
+}
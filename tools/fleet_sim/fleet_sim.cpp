@@ -0,0 +1,793 @@
+// Fleet simulator: N virtual stations in one Linux process.
+//
+// Each virtual station models the station loop from src/main.cpp: poll the
+// ISS endpoint, extract the record with the same REST schema code
+// (rest_schema.cpp), publish the coordinates JSON when the timestamp changes,
+// and batch history frames with the coordinate codec (coord_codec.cpp).
+// Publishing follows MqttAsyncClient rather than sharing its code: QoS 1
+// with a 4-message in-flight window and a 12-message queue, a persistent
+// session with DUP resends after a reconnect, and reconnects with jittered
+// exponential backoff from 1 s to 30 s. Stations are stepped by a fixed pool
+// of worker threads, so one process can drive hundreds of them.
+//
+// A monitor subscribes to every station topic and measures end-to-end
+// latency: stub server sample generation -> broker delivery.
+//
+// Build and run from the repository root:
+//   g++ -std=gnu++11 -O2 -pthread -Iinclude -Itools/fleet_sim tools/fleet_sim/*.cpp
+//       src/rest_schema.cpp src/coord_codec.cpp -o fleet_sim
+//   ./fleet_sim --stations 500 --duration 60 --storm-every 20
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coord_codec.h"
+#include "rest_poller.h"
+#include "sim_mqtt.h"
+#include "sim_net.h"
+#include "stub_iss_server.h"
+
+// ========== Configuration ==========
+
+struct SimConfig {
+  unsigned stations;
+  unsigned workers;
+  unsigned durationS;
+  unsigned reportS;
+  uint32_t fetchMs;         // ISS poll period per station
+  uint32_t loopMs;          // station loop cadence (delay(100) in main.cpp)
+  uint32_t historyBatch;    // samples per history publish
+  uint32_t reconnectMs;     // first retry delay after a failed MQTT connect
+  uint32_t backoffMaxMs;    // backoff cap, 0 = fixed retry interval
+  unsigned qos;             // 1 like the firmware, 0 for fire-and-forget
+  unsigned inflight;        // QoS 1 window (mqtt_window, default 4)
+  unsigned queueCap;        // QoS 1 messages held (MQTT_ASYNC_POOL_SIZE)
+  uint16_t keepAliveS;
+  double httpLoss;
+  uint32_t httpLatencyMs;
+  uint32_t httpJitterMs;
+  double mqttLoss;          // publishes lost before reaching the broker
+  uint32_t mqttLatencyMs;   // extra uplink delay before each publish
+  unsigned stormEveryS;     // 0 = no reconnect storms
+  double stormFraction;     // share of stations dropped per storm
+  std::string brokerHost;   // empty = embedded broker
+  uint16_t brokerPort;
+  std::string topicPrefix;
+  uint32_t seed;
+};
+
+static SimConfig defaultConfig() {
+  SimConfig c;
+  c.stations = 100;
+  c.workers = 16;
+  c.durationS = 30;
+  c.reportS = 5;
+  c.fetchMs = 2000;
+  c.loopMs = 100;
+  c.historyBatch = 16;
+  c.reconnectMs = 1000;
+  c.backoffMaxMs = 30000;
+  c.qos = 1;
+  c.inflight = 4;
+  c.queueCap = 12;
+  c.keepAliveS = 15;
+  c.httpLoss = 0;
+  c.httpLatencyMs = 0;
+  c.httpJitterMs = 0;
+  c.mqttLoss = 0;
+  c.mqttLatencyMs = 0;
+  c.stormEveryS = 0;
+  c.stormFraction = 1.0;
+  c.brokerPort = 1883;
+  c.topicPrefix = "sim";
+  c.seed = 1;
+  return c;
+}
+
+static void usage() {
+  printf("Usage: fleet_sim [options]\n"
+         "  --stations N          virtual stations (100)\n"
+         "  --workers N           worker threads (16)\n"
+         "  --duration S          run time in seconds (30)\n"
+         "  --report S            progress line period (5)\n"
+         "  --fetch-ms MS         ISS poll period per station (2000)\n"
+         "  --history-batch N     samples per history publish (16)\n"
+         "  --reconnect-ms MS     first MQTT retry delay (1000)\n"
+         "  --backoff-max-ms MS   backoff cap, jittered and doubling (30000, 0 = fixed)\n"
+         "  --qos N               publish QoS, 0 or 1 (1)\n"
+         "  --inflight N          QoS 1 messages awaiting PUBACK (4)\n"
+         "  --queue N             QoS 1 messages held while offline (12)\n"
+         "  --http-loss P         probability the stub drops a request (0)\n"
+         "  --http-latency MS     stub response delay (0)\n"
+         "  --http-jitter MS      extra random stub delay, 0..MS (0)\n"
+         "  --mqtt-loss P         probability a publish is lost on the uplink (0)\n"
+         "  --mqtt-latency MS     uplink delay before each publish (0)\n"
+         "  --storm-every S       drop station links every S seconds (0 = off)\n"
+         "  --storm-fraction F    share of stations dropped per storm (1.0)\n"
+         "  --broker HOST:PORT    external broker instead of the embedded one\n"
+         "  --prefix TOPIC        topic prefix (sim)\n"
+         "  --seed N              random seed (1)\n");
+}
+
+static bool parseArgs(int argc, char** argv, SimConfig& c) {
+  for (int i = 1; i < argc; i++) {
+    const char* opt = argv[i];
+    if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) return false;
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Missing value for %s\n", opt);
+      return false;
+    }
+    const char* v = argv[++i];
+    if (strcmp(opt, "--stations") == 0) c.stations = (unsigned)atoi(v);
+    else if (strcmp(opt, "--workers") == 0) c.workers = (unsigned)atoi(v);
+    else if (strcmp(opt, "--duration") == 0) c.durationS = (unsigned)atoi(v);
+    else if (strcmp(opt, "--report") == 0) c.reportS = (unsigned)atoi(v);
+    else if (strcmp(opt, "--fetch-ms") == 0) c.fetchMs = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--history-batch") == 0) c.historyBatch = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--reconnect-ms") == 0) c.reconnectMs = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--backoff-max-ms") == 0) c.backoffMaxMs = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--qos") == 0) c.qos = (unsigned)atoi(v);
+    else if (strcmp(opt, "--inflight") == 0) c.inflight = (unsigned)atoi(v);
+    else if (strcmp(opt, "--queue") == 0) c.queueCap = (unsigned)atoi(v);
+    else if (strcmp(opt, "--http-loss") == 0) c.httpLoss = atof(v);
+    else if (strcmp(opt, "--http-latency") == 0) c.httpLatencyMs = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--http-jitter") == 0) c.httpJitterMs = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--mqtt-loss") == 0) c.mqttLoss = atof(v);
+    else if (strcmp(opt, "--mqtt-latency") == 0) c.mqttLatencyMs = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--storm-every") == 0) c.stormEveryS = (unsigned)atoi(v);
+    else if (strcmp(opt, "--storm-fraction") == 0) c.stormFraction = atof(v);
+    else if (strcmp(opt, "--prefix") == 0) c.topicPrefix = v;
+    else if (strcmp(opt, "--seed") == 0) c.seed = (uint32_t)atoi(v);
+    else if (strcmp(opt, "--broker") == 0) {
+      const char* colon = strrchr(v, ':');
+      c.brokerHost = colon ? std::string(v, colon - v) : std::string(v);
+      if (colon) c.brokerPort = (uint16_t)atoi(colon + 1);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", opt);
+      return false;
+    }
+  }
+  if (c.stations == 0 || c.workers == 0 || c.durationS == 0 || c.historyBatch == 0 || c.historyBatch > 32) {
+    fprintf(stderr, "stations, workers and duration must be > 0, history-batch 1..32\n");
+    return false;
+  }
+  if (c.qos > 1 || c.inflight == 0 || c.inflight > 8 || c.queueCap < c.inflight) {
+    fprintf(stderr, "qos must be 0 or 1, inflight 1..8, queue >= inflight\n");
+    return false;
+  }
+  return true;
+}
+
+// xorshift32
+static uint32_t nextRandom(uint32_t& s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static double unitRandom(uint32_t& s) {
+  return (nextRandom(s) >> 8) / 16777216.0;
+}
+
+// ========== Shared schema ==========
+
+// Same fields as issNowFields in main.cpp, plus the stub's generation stamp
+struct SimIssRecord {
+  char message[16];
+  float latitude;
+  float longitude;
+  unsigned long timestamp;
+  unsigned long long simUs;
+};
+
+static constexpr RestField simIssFields[] = {
+  REST_FIELD(SimIssRecord, message, "message"),
+  REST_FIELD(SimIssRecord, latitude, "iss_position.latitude"),
+  REST_FIELD(SimIssRecord, longitude, "iss_position.longitude"),
+  REST_FIELD(SimIssRecord, timestamp, "timestamp"),
+  REST_FIELD(SimIssRecord, simUs, "sim_us"),
+};
+REST_SCHEMA_CHECK(simIssFields);
+
+// What the monitor reads back from a coordinates publish
+struct SimCoordsRecord {
+  unsigned long long simUs;
+};
+
+static constexpr RestField simCoordsFields[] = {
+  REST_FIELD(SimCoordsRecord, simUs, "sim_us"),
+};
+REST_SCHEMA_CHECK(simCoordsFields);
+
+// ========== Counters ==========
+
+struct SimCounters {
+  std::atomic<uint64_t> fetchOk;
+  std::atomic<uint64_t> fetchFailed;
+  std::atomic<uint64_t> published;
+  std::atomic<uint64_t> publishLost;      // injected uplink loss
+  std::atomic<uint64_t> publishSkipped;   // QoS 0 while not connected
+  std::atomic<uint64_t> publishDropped;   // QoS 1 queue full
+  std::atomic<uint64_t> historyPublished;
+  std::atomic<uint64_t> connectAttempts;
+  std::atomic<uint64_t> connectOk;
+  std::atomic<uint64_t> sessionsResumed;  // CONNACK with session present
+  std::atomic<uint32_t> connected;        // stations currently connected
+};
+
+static SimCounters counters;
+
+// A reconnect storm: affected stations lose their link at startUs
+struct Storm {
+  uint64_t startUs;
+  uint32_t affected;
+  std::atomic<uint32_t> recovered;
+  std::atomic<uint64_t> lastRecoveredUs;
+};
+
+static const unsigned MAX_STORMS = 128;
+static Storm storms[MAX_STORMS]; // storms[0] = initial connect of the fleet
+static std::atomic<unsigned> stormCount(0);
+
+// ========== Virtual station ==========
+
+struct Station {
+  unsigned id;
+  char clientId[32];
+  char topicCoords[64];
+  char topicHistory[64];
+  uint32_t rng;
+
+  SimMqttClient mqtt;
+  bool linkUp;                 // counted in counters.connected
+  uint64_t nextConnectUs;
+  uint32_t failedConnects;
+  std::atomic<int> kickStorm;  // set by the storm thread: drop the link
+  std::atomic<int> recoveringStorm; // storm waiting for this station to reconnect, -1 = none
+
+  uint64_t nextFetchUs;
+  unsigned long lastPublishedTimestamp;
+
+  // Deferred publish when uplink latency is injected
+  bool pending;
+  uint64_t pendingDueUs;
+  char pendingPayload[256];
+
+  CoordStreamEncoder historyEncoder;
+  uint8_t historyBatch[32 * COORD_CODEC_MAX_FRAME];
+  size_t historyBatchLen;
+  uint32_t historyBatchCount;
+
+  Station() : historyEncoder(16) {}
+};
+
+static SimConfig config;
+static uint16_t httpPort;
+static std::string brokerHost;
+static uint16_t brokerPort;
+
+static void noteRecovered(Station& st, uint64_t now) {
+  if (st.recoveringStorm < 0) return;
+  Storm& s = storms[st.recoveringStorm];
+  uint64_t prev = s.lastRecoveredUs.load();
+  while (prev < now && !s.lastRecoveredUs.compare_exchange_weak(prev, now)) {}
+  s.recovered++;
+  st.recoveringStorm = -1;
+}
+
+static void stationConnect(Station& st, uint64_t now) {
+  counters.connectAttempts++;
+  // Fixed client id and clean session off, as in MqttAsyncClient::begin()
+  if (st.mqtt.connect(brokerHost.c_str(), brokerPort, st.clientId, config.keepAliveS, 2000, false)) {
+    counters.connectOk++;
+    if (st.mqtt.sessionPresent()) counters.sessionsResumed++;
+    counters.connected++;
+    st.linkUp = true;
+    st.failedConnects = 0;
+    noteRecovered(st, simNowUs());
+    return;
+  }
+
+  // Capped exponential backoff with jitter, like MqttAsyncClient::run()
+  uint64_t delayMs = config.reconnectMs;
+  if (config.backoffMaxMs) {
+    uint32_t shift = std::min<uint32_t>(st.failedConnects, 16);
+    delayMs = std::min<uint64_t>((uint64_t)config.reconnectMs << shift, config.backoffMaxMs);
+    delayMs = delayMs / 2 + (uint64_t)(unitRandom(st.rng) * (delayMs / 2));
+  }
+  st.failedConnects++;
+  st.nextConnectUs = now + delayMs * 1000;
+}
+
+// The client closes itself on socket errors and overdue PUBACKs: notice it
+static void stationCheckLink(Station& st, uint64_t now) {
+  if (!st.linkUp || st.mqtt.connected()) return;
+  st.linkUp = false;
+  counters.connected--;
+  st.nextConnectUs = now; // first retry right away, then back off
+}
+
+static void stationLinkLost(Station& st, uint64_t now) {
+  st.mqtt.disconnect(false);
+  stationCheckLink(st, now);
+}
+
+static bool stationSend(Station& st, const char* topic, const uint8_t* payload, size_t len) {
+  bool ok;
+  if (config.qos == 0) {
+    if (!st.mqtt.connected()) {
+      counters.publishSkipped++;
+      return false;
+    }
+    ok = st.mqtt.publish(topic, payload, len, 0);
+  } else {
+    // Held while offline until the queue is full, as in MqttAsyncClient
+    ok = st.mqtt.publish(topic, payload, len, 1);
+    if (!ok) counters.publishDropped++;
+  }
+  stationCheckLink(st, simNowUs());
+  return ok;
+}
+
+// Blocking GET, like HTTPClient in sendHTTPGetParsed()
+static bool fetchIss(SimIssRecord& rec) {
+  int fd = simConnect("127.0.0.1", httpPort, 2000);
+  if (fd < 0) return false;
+  simSetRecvTimeout(fd, 5000);
+
+  char req[128];
+  int reqLen = snprintf(req, sizeof(req),
+      "GET /iss-now.json HTTP/1.1\r\nHost: 127.0.0.1:%u\r\nConnection: close\r\n\r\n", httpPort);
+  if (!simSendAll(fd, req, (size_t)reqLen)) {
+    simClose(fd);
+    return false;
+  }
+
+  char resp[1024];
+  size_t len = 0;
+  ssize_t n;
+  while (len < sizeof(resp) - 1 && (n = recv(fd, resp + len, sizeof(resp) - 1 - len, 0)) > 0) {
+    len += (size_t)n;
+  }
+  simClose(fd);
+  resp[len] = '\0';
+
+  const char* body = strstr(resp, "\r\n\r\n");
+  if (strncmp(resp, "HTTP/1.1 200", 12) != 0 || body == nullptr) return false;
+  body += 4;
+
+  memset(&rec, 0, sizeof(rec));
+  uint32_t found = restExtract(body, len - (body - resp), simIssFields, REST_SCHEMA_COUNT(simIssFields), &rec);
+  const uint32_t allFields = (1u << REST_SCHEMA_COUNT(simIssFields)) - 1;
+  return found == allFields && strcmp(rec.message, "success") == 0;
+}
+
+static void stationPublish(Station& st, const char* payload) {
+  if (unitRandom(st.rng) < config.mqttLoss) {
+    counters.publishLost++;
+    return;
+  }
+  if (stationSend(st, st.topicCoords, (const uint8_t*)payload, strlen(payload))) counters.published++;
+}
+
+// History batch as in flushHistoryBatch() / appendHistorySample()
+static void stationFlushHistory(Station& st) {
+  if (stationSend(st, st.topicHistory, st.historyBatch, st.historyBatchLen)) {
+    counters.historyPublished++;
+  }
+  st.historyBatchLen = 0;
+  st.historyBatchCount = 0;
+}
+
+static void stationAppendHistory(Station& st, const SimIssRecord& rec) {
+  CoordSample sample = {coordToFixed(rec.latitude), coordToFixed(rec.longitude), (uint32_t)rec.timestamp};
+
+  if (st.historyBatchCount == 0) st.historyEncoder.forceKeyframe();
+  size_t n = st.historyEncoder.encode(sample, st.historyBatch + st.historyBatchLen,
+                                      sizeof(st.historyBatch) - st.historyBatchLen);
+  if (n == 0 && st.historyBatchCount > 0) {
+    // Buffer full: ship what we have, the sample opens the next batch
+    stationFlushHistory(st);
+    st.historyEncoder.forceKeyframe();
+    n = st.historyEncoder.encode(sample, st.historyBatch, sizeof(st.historyBatch));
+  }
+  if (n == 0) return; // does not fit in a batch at all
+  st.historyBatchLen += n;
+  st.historyBatchCount++; // only samples actually in the payload
+
+  if (st.historyBatchCount < config.historyBatch) return;
+  stationFlushHistory(st);
+}
+
+// One loop() iteration. Returns the time of the next wake-up.
+static uint64_t stationStep(Station& st) {
+  uint64_t now = simNowUs();
+
+  int storm = st.kickStorm.exchange(-1);
+  if (storm >= 0) {
+    stationLinkLost(st, now);
+    st.recoveringStorm = storm;
+    st.nextConnectUs = now;
+    st.failedConnects = 0;
+  }
+
+  if (!st.mqtt.connected() && now >= st.nextConnectUs) {
+    stationConnect(st, now);
+  }
+  if (st.mqtt.connected()) {
+    st.mqtt.poll(0, nullptr, nullptr); // PUBACKs, window refill, keep-alive
+    stationCheckLink(st, now);
+  }
+
+  if (now >= st.nextFetchUs) {
+    st.nextFetchUs = now + (uint64_t)config.fetchMs * 1000;
+    SimIssRecord rec;
+    if (fetchIss(rec)) {
+      counters.fetchOk++;
+      if (rec.timestamp != st.lastPublishedTimestamp) {
+        st.lastPublishedTimestamp = rec.timestamp;
+        uint64_t rxMs = simNowUs() / 1000;
+        snprintf(st.pendingPayload, sizeof(st.pendingPayload),
+                 "{\"latitude\":%.6f,\"longitude\":%.6f,\"timestamp\":%lu,\"rx\":%llu,\"sim_us\":%llu}",
+                 rec.latitude, rec.longitude, rec.timestamp,
+                 (unsigned long long)rxMs, (unsigned long long)rec.simUs);
+        if (config.mqttLatencyMs) {
+          // A sample still waiting on the uplink is replaced by the newer one
+          if (st.pending) counters.publishLost++;
+          st.pending = true;
+          st.pendingDueUs = simNowUs() + (uint64_t)config.mqttLatencyMs * 1000;
+        } else {
+          stationPublish(st, st.pendingPayload);
+        }
+        stationAppendHistory(st, rec);
+      }
+    } else {
+      counters.fetchFailed++;
+    }
+  }
+
+  now = simNowUs();
+  if (st.pending && now >= st.pendingDueUs) {
+    st.pending = false;
+    stationPublish(st, st.pendingPayload);
+  }
+
+  uint64_t next = now + (uint64_t)config.loopMs * 1000;
+  next = std::min(next, st.nextFetchUs);
+  if (st.pending) next = std::min(next, st.pendingDueUs);
+  // MqttAsyncClient's network task wakes every 10 ms while messages are queued
+  if (st.mqtt.connected() && st.mqtt.pending()) next = std::min(next, now + 10000);
+  if (!st.mqtt.connected()) next = std::min(next, std::max(st.nextConnectUs, now));
+  return next;
+}
+
+// ========== Worker pool ==========
+
+// Every station has exactly one entry in the queue, so two workers never
+// step the same station
+class StationScheduler {
+public:
+  typedef std::pair<uint64_t, unsigned> Entry; // (due, station index)
+
+  void push(uint64_t due, unsigned index) {
+    std::lock_guard<std::mutex> lock(mtx);
+    queue.push(Entry(due, index));
+    cv.notify_one();
+  }
+
+  // Blocks until a station is due. Returns false on shutdown.
+  bool pop(unsigned* index) {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopped) {
+      if (queue.empty()) {
+        cv.wait(lock);
+        continue;
+      }
+      uint64_t due = queue.top().first;
+      uint64_t now = simNowUs();
+      if (due <= now) {
+        *index = queue.top().second;
+        queue.pop();
+        return true;
+      }
+      cv.wait_for(lock, std::chrono::microseconds(due - now));
+    }
+    return false;
+  }
+
+  void stop() {
+    std::lock_guard<std::mutex> lock(mtx);
+    stopped = true;
+    cv.notify_all();
+  }
+
+private:
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+  bool stopped = false;
+};
+
+static void workerLoop(StationScheduler* sched, std::vector<Station*>* fleet) {
+  unsigned index;
+  while (sched->pop(&index)) {
+    uint64_t next = stationStep(*(*fleet)[index]);
+    sched->push(next, index);
+  }
+}
+
+// ========== Monitor ==========
+
+struct Monitor {
+  SimMqttClient mqtt;
+  std::vector<uint32_t> latencyUs;
+  uint64_t coords;
+  uint64_t historyBatches;
+  uint64_t historySamples;
+  uint64_t historyErrors;
+};
+
+static void onMonitorMessage(void* ctx, const char* topic, const uint8_t* payload, size_t len) {
+  Monitor& m = *(Monitor*)ctx;
+  uint64_t now = simNowUs();
+  size_t topicLen = strlen(topic);
+
+  if (topicLen > 12 && strcmp(topic + topicLen - 12, "/coordonnees") == 0) {
+    SimCoordsRecord rec = {0};
+    if (restExtract((const char*)payload, len, simCoordsFields, 1, &rec) & 1) {
+      m.latencyUs.push_back(rec.simUs < now ? (uint32_t)(now - rec.simUs) : 0);
+    }
+    m.coords++;
+  } else if (topicLen > 11 && strcmp(topic + topicLen - 11, "/historique") == 0) {
+    // Each batch must decode on its own (starts with a keyframe)
+    CoordStreamDecoder decoder;
+    size_t pos = 0;
+    while (pos < len) {
+      CoordSample sample;
+      size_t used = 0;
+      if (decoder.decode(payload + pos, len - pos, &sample, &used) != COORD_DECODE_OK) {
+        m.historyErrors++;
+        break;
+      }
+      m.historySamples++;
+      pos += used;
+    }
+    m.historyBatches++;
+  }
+}
+
+static void monitorLoop(Monitor* m, std::atomic<bool>* running) {
+  std::string filter = config.topicPrefix + "/#";
+  while (*running) {
+    if (!m->mqtt.connected()) {
+      if (!m->mqtt.connect(brokerHost.c_str(), brokerPort, "fleet-sim-monitor", 60, 2000) ||
+          !m->mqtt.subscribe(filter.c_str(), 2000)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        continue;
+      }
+    }
+    m->mqtt.poll(50, onMonitorMessage, m);
+  }
+  // Drain what is still in flight
+  uint64_t until = simNowUs() + 500000;
+  while (m->mqtt.connected() && simNowUs() < until) m->mqtt.poll(50, onMonitorMessage, m);
+}
+
+// ========== Report ==========
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+static void printStorm(unsigned k) {
+  Storm& s = storms[k];
+  const char* label = k == 0 ? "Initial connect" : "Storm";
+  if (s.affected == 0) return;
+  if (s.recovered.load() >= s.affected) {
+    printf("[SIM] %s #%u at %.1f s: %u station(s) reconnected in %.0f ms\n", label, k,
+           s.startUs / 1e6, s.affected, (s.lastRecoveredUs.load() - s.startUs) / 1000.0);
+  } else {
+    printf("[SIM] %s #%u at %.1f s: %u/%u station(s) reconnected, not converged\n", label, k,
+           s.startUs / 1e6, s.recovered.load(), s.affected);
+  }
+}
+
+int main(int argc, char** argv) {
+  config = defaultConfig();
+  if (!parseArgs(argc, argv, config)) {
+    usage();
+    return 1;
+  }
+  simNowUs(); // start the shared clock
+
+  StubFaults faults = {config.httpLoss, config.httpLatencyMs, config.httpJitterMs};
+  StubIssServer stub;
+  // One handler per worker is enough: each worker has at most one request open
+  if (!stub.start(0, config.workers + 2, faults)) {
+    fprintf(stderr, "Cannot start stub ISS server\n");
+    return 1;
+  }
+  httpPort = stub.port();
+
+  SimMqttBroker broker;
+  if (config.brokerHost.empty()) {
+    if (!broker.start(0)) {
+      fprintf(stderr, "Cannot start embedded broker\n");
+      return 1;
+    }
+    brokerHost = "127.0.0.1";
+    brokerPort = broker.port();
+  } else {
+    brokerHost = config.brokerHost;
+    brokerPort = config.brokerPort;
+  }
+
+  printf("[SIM] %u station(s), %u worker(s), %u s, ISS stub on :%u, broker %s:%u%s\n",
+         config.stations, config.workers, config.durationS, httpPort, brokerHost.c_str(), brokerPort,
+         config.brokerHost.empty() ? " (embedded)" : "");
+
+  Monitor monitor;
+  monitor.coords = monitor.historyBatches = monitor.historySamples = monitor.historyErrors = 0;
+  std::atomic<bool> monitorRunning(true);
+  std::thread monitorThread(monitorLoop, &monitor, &monitorRunning);
+  // Let the monitor subscribe before the first publish
+  for (int i = 0; i < 40 && !monitor.mqtt.connected(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  // Storm #0: the whole fleet connecting at once
+  uint64_t start = simNowUs();
+  storms[0].startUs = start;
+  storms[0].affected = config.stations;
+  storms[0].recovered = 0;
+  storms[0].lastRecoveredUs = 0;
+  stormCount = 1;
+
+  std::vector<Station*> fleet;
+  StationScheduler sched;
+  uint32_t rng = config.seed * 2654435761u + 1;
+  for (unsigned i = 0; i < config.stations; i++) {
+    Station* st = new Station();
+    st->id = i;
+    snprintf(st->clientId, sizeof(st->clientId), "sim-%04u", i);
+    snprintf(st->topicCoords, sizeof(st->topicCoords), "%s/%04u/coordonnees", config.topicPrefix.c_str(), i);
+    snprintf(st->topicHistory, sizeof(st->topicHistory), "%s/%04u/historique", config.topicPrefix.c_str(), i);
+    st->rng = nextRandom(rng) | 1;
+    st->mqtt.setQos1Limits(config.inflight, config.queueCap);
+    st->linkUp = false;
+    st->nextConnectUs = start;
+    st->failedConnects = 0;
+    st->kickStorm = -1;
+    st->recoveringStorm = 0;
+    // Spread the first fetches over one period, like boards booting at different times
+    st->nextFetchUs = start + (uint64_t)(unitRandom(rng) * config.fetchMs * 1000);
+    st->lastPublishedTimestamp = 0;
+    st->pending = false;
+    st->historyBatchLen = 0;
+    st->historyBatchCount = 0;
+    fleet.push_back(st);
+    sched.push(start, i);
+  }
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < config.workers; i++) workers.push_back(std::thread(workerLoop, &sched, &fleet));
+
+  // Main thread: progress, storms
+  uint64_t end = start + (uint64_t)config.durationS * 1000000;
+  uint64_t nextReport = start + (uint64_t)config.reportS * 1000000;
+  uint64_t nextStorm = config.stormEveryS ? start + (uint64_t)config.stormEveryS * 1000000 : UINT64_MAX;
+  uint64_t lastPublished = 0;
+  while (simNowUs() < end) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t now = simNowUs();
+
+    if (now >= nextStorm) {
+      nextStorm += (uint64_t)config.stormEveryS * 1000000;
+      unsigned k = stormCount.load();
+      if (k < MAX_STORMS) {
+        Storm& s = storms[k];
+        s.startUs = now;
+        s.recovered = 0;
+        s.lastRecoveredUs = 0;
+        s.affected = 0;
+        // Pick the victims first so the count is final before anyone recovers
+        std::vector<Station*> victims;
+        // Stations still down from an earlier storm are counted there
+        for (size_t i = 0; i < fleet.size(); i++) {
+          Station* st = fleet[i];
+          if (st->kickStorm.load() >= 0 || st->recoveringStorm.load() >= 0) continue;
+          if (unitRandom(rng) < config.stormFraction) victims.push_back(st);
+        }
+        s.affected = (uint32_t)victims.size();
+        stormCount = k + 1;
+        for (size_t i = 0; i < victims.size(); i++) victims[i]->kickStorm = (int)k;
+        printf("[SIM] Storm #%u: dropping %u station link(s)\n", k, s.affected);
+      }
+    }
+
+    if (config.reportS && now >= nextReport) {
+      nextReport += (uint64_t)config.reportS * 1000000;
+      uint64_t published = counters.published.load();
+      printf("[SIM] t=%3.0f s  connected %u/%u  published %llu (%.0f/s)  fetch ok %llu failed %llu\n",
+             (now - start) / 1e6, counters.connected.load(), config.stations,
+             (unsigned long long)published, (published - lastPublished) / (double)config.reportS,
+             (unsigned long long)counters.fetchOk.load(), (unsigned long long)counters.fetchFailed.load());
+      lastPublished = published;
+    }
+  }
+
+  sched.stop();
+  for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+  double elapsedS = (simNowUs() - start) / 1e6;
+  monitorRunning = false;
+  monitorThread.join();
+
+  // ========== Final report ==========
+  printf("\n[SIM] ===== Results (%.1f s) =====\n", elapsedS);
+  printf("[SIM] HTTP: %llu ok, %llu failed (stub served %llu, dropped %llu)\n",
+         (unsigned long long)counters.fetchOk.load(), (unsigned long long)counters.fetchFailed.load(),
+         (unsigned long long)stub.requests(), (unsigned long long)stub.dropped());
+  printf("[SIM] MQTT connects: %llu ok / %llu attempts, %llu sessions resumed\n",
+         (unsigned long long)counters.connectOk.load(), (unsigned long long)counters.connectAttempts.load(),
+         (unsigned long long)counters.sessionsResumed.load());
+  printf("[SIM] Published (QoS %u): %llu coords (%.1f/s), %llu history batches; lost on uplink %llu, "
+         "not connected %llu, queue full %llu\n", config.qos,
+         (unsigned long long)counters.published.load(), counters.published.load() / elapsedS,
+         (unsigned long long)counters.historyPublished.load(), (unsigned long long)counters.publishLost.load(),
+         (unsigned long long)counters.publishSkipped.load(), (unsigned long long)counters.publishDropped.load());
+  if (config.qos == 1) {
+    SimQos1Stats q = {};
+    uint64_t unacked = 0;
+    for (size_t i = 0; i < fleet.size(); i++) {
+      const SimQos1Stats& s = fleet[i]->mqtt.qos1Stats();
+      q.acked += s.acked;
+      q.resent += s.resent;
+      q.ackTimeouts += s.ackTimeouts;
+      q.ackRttUsTotal += s.ackRttUsTotal;
+      unacked += fleet[i]->mqtt.pending();
+    }
+    printf("[SIM] QoS 1: %llu acked (avg %.2f ms), %llu resent with DUP, %llu ack timeouts, %llu still queued\n",
+           (unsigned long long)q.acked, q.acked ? q.ackRttUsTotal / 1000.0 / q.acked : 0.0,
+           (unsigned long long)q.resent, (unsigned long long)q.ackTimeouts, (unsigned long long)unacked);
+  }
+  printf("[SIM] Received: %llu coords (%.1f/s), %llu history batches (%llu samples, %llu decode errors)\n",
+         (unsigned long long)monitor.coords, monitor.coords / elapsedS,
+         (unsigned long long)monitor.historyBatches, (unsigned long long)monitor.historySamples,
+         (unsigned long long)monitor.historyErrors);
+  if (config.brokerHost.empty()) {
+    SimBrokerStats b = broker.stats();
+    printf("[SIM] Broker: %llu connects, %llu takeovers, %llu publishes in, %llu deliveries\n",
+           (unsigned long long)b.connects, (unsigned long long)b.takeovers,
+           (unsigned long long)b.publishesIn, (unsigned long long)b.publishesOut);
+  }
+
+  std::vector<uint32_t>& lat = monitor.latencyUs;
+  std::sort(lat.begin(), lat.end());
+  printf("[SIM] End-to-end latency (ms, %zu samples): p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+         lat.size(), percentile(lat, 0.50) / 1000.0, percentile(lat, 0.90) / 1000.0,
+         percentile(lat, 0.99) / 1000.0, percentile(lat, 0.999) / 1000.0,
+         lat.empty() ? 0.0 : lat.back() / 1000.0);
+
+  for (unsigned k = 0; k < stormCount.load(); k++) printStorm(k);
+
+  for (size_t i = 0; i < fleet.size(); i++) delete fleet[i];
+  broker.stop();
+  stub.stop();
+  return 0;
+}
@@ -0,0 +1,502 @@
+#include "sim_mqtt.h"
+#include "sim_net.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+
+// ========== Packet encoding ==========
+
+enum {
+  MQTT_CONNECT = 1,
+  MQTT_CONNACK = 2,
+  MQTT_PUBLISH = 3,
+  MQTT_PUBACK = 4,
+  MQTT_SUBSCRIBE = 8,
+  MQTT_SUBACK = 9,
+  MQTT_UNSUBSCRIBE = 10,
+  MQTT_UNSUBACK = 11,
+  MQTT_PINGREQ = 12,
+  MQTT_PINGRESP = 13,
+  MQTT_DISCONNECT = 14
+};
+
+static void putLength(std::vector<uint8_t>& out, size_t len) {
+  do {
+    uint8_t b = len & 0x7F;
+    len >>= 7;
+    if (len) b |= 0x80;
+    out.push_back(b);
+  } while (len);
+}
+
+static void putString(std::vector<uint8_t>& out, const char* s, size_t len) {
+  out.push_back((uint8_t)(len >> 8));
+  out.push_back((uint8_t)len);
+  out.insert(out.end(), s, s + len);
+}
+
+// Fixed header + body
+static std::vector<uint8_t> makePacket(uint8_t header, const std::vector<uint8_t>& body) {
+  std::vector<uint8_t> pkt;
+  pkt.reserve(body.size() + 5);
+  pkt.push_back(header);
+  putLength(pkt, body.size());
+  pkt.insert(pkt.end(), body.begin(), body.end());
+  return pkt;
+}
+
+// packetId 0 = QoS 0
+static std::vector<uint8_t> makePublish(const char* topic, size_t topicLen, const uint8_t* payload, size_t len,
+                                        uint16_t packetId = 0) {
+  std::vector<uint8_t> body;
+  body.reserve(topicLen + len + 4);
+  putString(body, topic, topicLen);
+  if (packetId) {
+    body.push_back((uint8_t)(packetId >> 8));
+    body.push_back((uint8_t)packetId);
+  }
+  body.insert(body.end(), payload, payload + len);
+  return makePacket((MQTT_PUBLISH << 4) | (packetId ? 0x02 : 0), body);
+}
+
+// Pop one complete packet from the front of rx. Returns 1 on success, 0 if
+// more bytes are needed, -1 if the length field is malformed.
+static int takePacket(std::vector<uint8_t>& rx, uint8_t* header, std::vector<uint8_t>& body) {
+  if (rx.size() < 2) return 0;
+  size_t len = 0;
+  size_t pos = 1;
+  for (int shift = 0;; shift += 7) {
+    if (shift > 21) return -1;
+    if (pos >= rx.size()) return 0;
+    uint8_t b = rx[pos++];
+    len |= (size_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  if (rx.size() < pos + len) return 0;
+  *header = rx[0];
+  body.assign(rx.begin() + pos, rx.begin() + pos + len);
+  rx.erase(rx.begin(), rx.begin() + pos + len);
+  return 1;
+}
+
+// Append whatever is readable on fd. Returns false on EOF or error.
+static bool readInto(int fd, std::vector<uint8_t>& rx) {
+  uint8_t buf[4096];
+  ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+  if (n > 0) {
+    rx.insert(rx.end(), buf, buf + n);
+    return true;
+  }
+  return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+bool simTopicMatches(const char* filter, const char* topic) {
+  while (*filter) {
+    if (*filter == '#') return true;
+    if (*filter == '+') {
+      while (*topic && *topic != '/') topic++;
+      filter++;
+      continue;
+    }
+    if (*filter != *topic) return false;
+    filter++;
+    topic++;
+  }
+  return *topic == '\0';
+}
+
+// ========== Client ==========
+
+// MqttAsyncClient: MQTT_ASYNC_ACK_TIMEOUT_MS, default window, MQTT_ASYNC_POOL_SIZE
+static const uint64_t ACK_TIMEOUT_US = 20000000;
+static const size_t DEFAULT_WINDOW = 4;
+static const size_t DEFAULT_CAPACITY = 12;
+
+SimMqttClient::SimMqttClient()
+    : fd(-1), keepAliveS(15), lastSendUs(0), lastSessionPresent(false), inflightCount(0),
+      window(DEFAULT_WINDOW), capacity(DEFAULT_CAPACITY), lastPacketId(0), qos1() {}
+
+SimMqttClient::~SimMqttClient() {
+  disconnect(false);
+}
+
+bool SimMqttClient::sendPacket(const std::vector<uint8_t>& pkt) {
+  if (fd < 0) return false;
+  if (!simSendAll(fd, pkt.data(), pkt.size())) {
+    disconnect(false);
+    return false;
+  }
+  lastSendUs = simNowUs();
+  return true;
+}
+
+bool SimMqttClient::waitPacket(uint8_t expectedType, int timeoutMs) {
+  uint64_t deadline = simNowUs() + (uint64_t)timeoutMs * 1000;
+  std::vector<uint8_t> body;
+  while (fd >= 0) {
+    uint8_t header;
+    int r = takePacket(rx, &header, body);
+    if (r < 0) break;
+    if (r > 0) {
+      if ((header >> 4) == MQTT_PUBACK) handleAck(body);
+      if ((header >> 4) != expectedType) continue; // ignore anything else meanwhile
+      if (expectedType == MQTT_CONNACK) {
+        if (body.size() < 2 || body[1] != 0) break;
+        lastSessionPresent = (body[0] & 0x01) != 0;
+      }
+      return true;
+    }
+    uint64_t now = simNowUs();
+    if (now >= deadline) break;
+    pollfd p = {fd, POLLIN, 0};
+    if (::poll(&p, 1, (int)((deadline - now) / 1000) + 1) < 0 || !readInto(fd, rx)) break;
+  }
+  disconnect(false);
+  return false;
+}
+
+bool SimMqttClient::connect(const char* host, uint16_t port, const char* clientId, uint16_t keepAlive, int timeoutMs,
+                            bool cleanSession) {
+  disconnect(false);
+  fd = simConnect(host, port, timeoutMs);
+  if (fd < 0) return false;
+  rx.clear();
+  keepAliveS = keepAlive;
+
+  std::vector<uint8_t> body;
+  putString(body, "MQTT", 4);
+  body.push_back(4);    // protocol level 3.1.1
+  body.push_back(cleanSession ? 0x02 : 0x00);
+  body.push_back((uint8_t)(keepAlive >> 8));
+  body.push_back((uint8_t)keepAlive);
+  putString(body, clientId, strlen(clientId));
+  if (!sendPacket(makePacket(MQTT_CONNECT << 4, body))) return false;
+  if (!waitPacket(MQTT_CONNACK, timeoutMs)) return false;
+
+  // Unacknowledged PUBLISHes go out again first, in their original order
+  for (size_t i = 0; i < inflightCount; i++) {
+    Outbound& m = outbound[i];
+    m.pkt[0] |= 0x08; // DUP
+    if (!sendPacket(m.pkt)) return false;
+    m.sentUs = lastSendUs;
+    qos1.resent++;
+  }
+  return sendWaiting();
+}
+
+void SimMqttClient::disconnect(bool graceful) {
+  if (fd < 0) return;
+  if (graceful) {
+    uint8_t pkt[2] = {MQTT_DISCONNECT << 4, 0};
+    simSendAll(fd, pkt, sizeof(pkt));
+  }
+  simClose(fd);
+  rx.clear();
+}
+
+void SimMqttClient::setQos1Limits(size_t w, size_t cap) {
+  window = w ? w : 1;
+  capacity = cap > window ? cap : window;
+}
+
+bool SimMqttClient::publish(const char* topic, const uint8_t* payload, size_t len, uint8_t qos) {
+  if (qos == 0) return sendPacket(makePublish(topic, strlen(topic), payload, len));
+
+  if (outbound.size() >= capacity) {
+    qos1.dropped++;
+    return false;
+  }
+  if (++lastPacketId == 0) lastPacketId = 1;
+  Outbound m;
+  m.pkt = makePublish(topic, strlen(topic), payload, len, lastPacketId);
+  m.packetId = lastPacketId;
+  m.sentUs = 0;
+  outbound.push_back(std::move(m));
+  // Queued even when offline; the window only moves while connected
+  if (fd >= 0) sendWaiting();
+  return true;
+}
+
+// Fill the window from the waiting messages. False if the link dropped.
+bool SimMqttClient::sendWaiting() {
+  while (fd >= 0 && inflightCount < window && inflightCount < outbound.size()) {
+    Outbound& m = outbound[inflightCount];
+    if (!sendPacket(m.pkt)) return false;
+    m.sentUs = lastSendUs;
+    inflightCount++;
+  }
+  return fd >= 0;
+}
+
+void SimMqttClient::handleAck(const std::vector<uint8_t>& body) {
+  if (body.size() < 2) return;
+  uint16_t id = (uint16_t)((body[0] << 8) | body[1]);
+  for (size_t i = 0; i < inflightCount; i++) {
+    if (outbound[i].packetId != id) continue;
+    qos1.acked++;
+    qos1.ackRttUsTotal += simNowUs() - outbound[i].sentUs;
+    outbound.erase(outbound.begin() + i);
+    inflightCount--;
+    return;
+  }
+}
+
+bool SimMqttClient::subscribe(const char* filter, int timeoutMs) {
+  std::vector<uint8_t> body;
+  body.push_back(0);
+  body.push_back(1); // packet id
+  putString(body, filter, strlen(filter));
+  body.push_back(0); // QoS 0
+  if (!sendPacket(makePacket((MQTT_SUBSCRIBE << 4) | 0x02, body))) return false;
+  return waitPacket(MQTT_SUBACK, timeoutMs);
+}
+
+bool SimMqttClient::poll(int waitMs, SimMqttHandler handler, void* ctx) {
+  if (fd < 0) return false;
+
+  pollfd p = {fd, POLLIN, 0};
+  int ready = ::poll(&p, 1, waitMs);
+  if (ready > 0 && !readInto(fd, rx)) {
+    disconnect(false);
+    return false;
+  }
+
+  std::vector<uint8_t> body;
+  uint8_t header;
+  int r;
+  while ((r = takePacket(rx, &header, body)) > 0) {
+    if ((header >> 4) == MQTT_PUBACK) handleAck(body);
+    if ((header >> 4) != MQTT_PUBLISH || body.size() < 2) continue;
+    size_t topicLen = ((size_t)body[0] << 8) | body[1];
+    size_t offset = 2 + topicLen + (((header >> 1) & 3) ? 2 : 0);
+    if (offset > body.size()) continue;
+    std::string topic((const char*)&body[2], topicLen);
+    if (handler) handler(ctx, topic.c_str(), body.data() + offset, body.size() - offset);
+  }
+  if (r < 0) {
+    disconnect(false);
+    return false;
+  }
+
+  // The oldest unacknowledged message waited too long: assume a dead link
+  if (inflightCount > 0 && simNowUs() - outbound[0].sentUs > ACK_TIMEOUT_US) {
+    qos1.ackTimeouts++;
+    disconnect(false);
+    return false;
+  }
+  if (!sendWaiting()) return false;
+
+  // MqttAsyncClient pings when nothing was sent for a keep-alive period
+  if (keepAliveS && simNowUs() - lastSendUs >= (uint64_t)keepAliveS * 1000000) {
+    uint8_t ping[2] = {MQTT_PINGREQ << 4, 0};
+    return sendPacket(std::vector<uint8_t>(ping, ping + 2));
+  }
+  return true;
+}
+
+// ========== Broker ==========
+
+SimMqttBroker::SimMqttBroker()
+    : listenFd(-1), boundPort(0), running(false), connects(0), takeovers(0),
+      publishesIn(0), publishesOut(0), clientCount(0) {}
+
+SimMqttBroker::~SimMqttBroker() {
+  stop();
+}
+
+bool SimMqttBroker::start(uint16_t port) {
+  listenFd = simListen(port, &boundPort);
+  if (listenFd < 0) return false;
+  // Non-blocking accept; accepted sockets stay blocking for writes
+  fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL, 0) | O_NONBLOCK);
+  running = true;
+  worker = std::thread(&SimMqttBroker::run, this);
+  return true;
+}
+
+void SimMqttBroker::stop() {
+  if (!running.exchange(false)) return;
+  worker.join();
+  for (size_t i = 0; i < sessions.size(); i++) simClose(sessions[i].fd);
+  sessions.clear();
+  simClose(listenFd);
+}
+
+SimBrokerStats SimMqttBroker::stats() const {
+  SimBrokerStats s;
+  s.connects = connects.load();
+  s.takeovers = takeovers.load();
+  s.publishesIn = publishesIn.load();
+  s.publishesOut = publishesOut.load();
+  s.clients = clientCount.load();
+  return s;
+}
+
+void SimMqttBroker::route(const std::string& topic, const uint8_t* payload, size_t len) {
+  std::vector<uint8_t> pkt;
+  for (size_t i = 0; i < sessions.size(); i++) {
+    Session& s = sessions[i];
+    if (s.fd < 0 || !s.connected) continue;
+    for (size_t f = 0; f < s.filters.size(); f++) {
+      if (!simTopicMatches(s.filters[f].c_str(), topic.c_str())) continue;
+      if (pkt.empty()) pkt = makePublish(topic.data(), topic.size(), payload, len);
+      if (simSendAll(s.fd, pkt.data(), pkt.size())) publishesOut++;
+      else simClose(s.fd);
+      break;
+    }
+  }
+}
+
+// Returns false when the session must be closed
+bool SimMqttBroker::handlePacket(size_t index, uint8_t header, const uint8_t* body, size_t len) {
+  uint8_t type = header >> 4;
+  if (!sessions[index].connected && type != MQTT_CONNECT) return false;
+
+  switch (type) {
+    case MQTT_CONNECT: {
+      // protocol name (6) + level + flags + keep-alive (2) + client id
+      if (len < 12) return false;
+      size_t idLen = ((size_t)body[10] << 8) | body[11];
+      if (12 + idLen > len) return false;
+      std::string clientId((const char*)body + 12, idLen);
+
+      // Only the session-present flag is modelled, not queued deliveries
+      bool cleanSession = (body[7] & 0x02) != 0;
+      bool sessionPresent = false;
+      if (cleanSession) {
+        persistentIds.erase(clientId);
+      } else {
+        sessionPresent = !persistentIds.insert(clientId).second;
+      }
+
+      // Same client id already connected: the new connection wins
+      for (size_t i = 0; i < sessions.size(); i++) {
+        if (i != index && sessions[i].fd >= 0 && sessions[i].connected && sessions[i].clientId == clientId) {
+          simClose(sessions[i].fd);
+          takeovers++;
+        }
+      }
+      Session& s = sessions[index];
+      s.clientId = clientId;
+      s.connected = true;
+      connects++;
+      uint8_t ack[4] = {MQTT_CONNACK << 4, 2, (uint8_t)(sessionPresent ? 1 : 0), 0};
+      return simSendAll(s.fd, ack, sizeof(ack));
+    }
+
+    case MQTT_PUBLISH: {
+      if (len < 2) return false;
+      size_t topicLen = ((size_t)body[0] << 8) | body[1];
+      uint8_t qos = (header >> 1) & 3;
+      size_t offset = 2 + topicLen + (qos ? 2 : 0);
+      if (offset > len) return false;
+      publishesIn++;
+      if (qos == 1) {
+        uint8_t ack[4] = {MQTT_PUBACK << 4, 2, body[2 + topicLen], body[3 + topicLen]};
+        if (!simSendAll(sessions[index].fd, ack, sizeof(ack))) return false;
+      }
+      route(std::string((const char*)body + 2, topicLen), body + offset, len - offset);
+      return true;
+    }
+
+    case MQTT_SUBSCRIBE:
+    case MQTT_UNSUBSCRIBE: {
+      if (len < 2) return false;
+      Session& s = sessions[index];
+      std::vector<uint8_t> ack;
+      ack.push_back(body[0]);
+      ack.push_back(body[1]);
+      size_t pos = 2;
+      while (pos + 2 <= len) {
+        size_t flen = ((size_t)body[pos] << 8) | body[pos + 1];
+        pos += 2;
+        if (pos + flen > len) return false;
+        std::string filter((const char*)body + pos, flen);
+        pos += flen;
+        if (type == MQTT_SUBSCRIBE) {
+          pos++; // requested QoS, always granted 0
+          s.filters.push_back(filter);
+          ack.push_back(0);
+        } else {
+          for (size_t f = 0; f < s.filters.size(); f++) {
+            if (s.filters[f] == filter) { s.filters.erase(s.filters.begin() + f); break; }
+          }
+        }
+      }
+      std::vector<uint8_t> pkt = makePacket((type == MQTT_SUBSCRIBE ? MQTT_SUBACK : MQTT_UNSUBACK) << 4, ack);
+      return simSendAll(s.fd, pkt.data(), pkt.size());
+    }
+
+    case MQTT_PINGREQ: {
+      uint8_t resp[2] = {MQTT_PINGRESP << 4, 0};
+      return simSendAll(sessions[index].fd, resp, sizeof(resp));
+    }
+
+    case MQTT_DISCONNECT:
+      return false;
+
+    default:
+      return true; // PUBACK etc. from clients, nothing to do at QoS 0
+  }
+}
+
+void SimMqttBroker::run() {
+  std::vector<pollfd> fds;
+  std::vector<uint8_t> body;
+
+  while (running) {
+    fds.clear();
+    pollfd lp = {listenFd, POLLIN, 0};
+    fds.push_back(lp);
+    for (size_t i = 0; i < sessions.size(); i++) {
+      pollfd p = {sessions[i].fd, POLLIN, 0};
+      fds.push_back(p);
+    }
+
+    // Short timeout so stop() is noticed
+    if (::poll(fds.data(), fds.size(), 100) <= 0) continue;
+
+    for (size_t i = 0; i < sessions.size(); i++) {
+      Session& s = sessions[i];
+      if (s.fd < 0 || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      if (!readInto(s.fd, s.rx)) {
+        simClose(s.fd);
+        continue;
+      }
+      uint8_t header;
+      int r;
+      while (sessions[i].fd >= 0 && (r = takePacket(sessions[i].rx, &header, body)) != 0) {
+        if (r < 0 || !handlePacket(i, header, body.data(), body.size())) {
+          simClose(sessions[i].fd);
+        }
+      }
+    }
+
+    // Drop closed sessions
+    size_t kept = 0;
+    for (size_t i = 0; i < sessions.size(); i++) {
+      if (sessions[i].fd >= 0) {
+        if (kept != i) sessions[kept] = std::move(sessions[i]);
+        kept++;
+      }
+    }
+    sessions.resize(kept);
+
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+        Session s;
+        s.fd = fd;
+        s.connected = false;
+        sessions.push_back(std::move(s));
+      }
+    }
+
+    uint32_t connected = 0;
+    for (size_t i = 0; i < sessions.size(); i++) connected += sessions[i].connected ? 1 : 0;
+    clientCount = connected;
+  }
+}
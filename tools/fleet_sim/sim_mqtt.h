@@ -0,0 +1,142 @@
+#ifndef SIM_MQTT_H
+#define SIM_MQTT_H
+
+// Minimal MQTT 3.1.1 pieces for the fleet simulator.
+//
+// SimMqttClient speaks what the station firmware uses through
+// MqttAsyncClient (mqtt_async.h): CONNECT with a persistent session, QoS 1
+// PUBLISH with an in-flight window and DUP resends after a reconnect, QoS 0
+// PUBLISH, SUBSCRIBE and keep-alive pings. SimMqttBroker is a
+// single-threaded poll() broker (QoS 0 fan-out, PUBACK for QoS 1, wildcard
+// filters, client-id takeover, session-present flag). It lets the harness
+// run with no external broker; pass --broker host:port to test a real one
+// (e.g. mosquitto).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef void (*SimMqttHandler)(void* ctx, const char* topic, const uint8_t* payload, size_t len);
+
+struct SimQos1Stats {
+  uint64_t acked;
+  uint64_t resent;      // DUP retransmissions after a reconnect
+  uint64_t dropped;     // queue full, publish refused
+  uint64_t ackTimeouts; // link dropped because a PUBACK never came
+  uint64_t ackRttUsTotal;
+};
+
+class SimMqttClient {
+public:
+  SimMqttClient();
+  ~SimMqttClient();
+
+  // Blocking CONNECT / CONNACK exchange. With cleanSession false, as on the
+  // board, QoS 1 messages still unacknowledged are resent with DUP set.
+  bool connect(const char* host, uint16_t port, const char* clientId, uint16_t keepAliveS, int timeoutMs,
+               bool cleanSession = true);
+  bool connected() const { return fd >= 0; }
+  bool sessionPresent() const { return lastSessionPresent; }
+  // graceful = send DISCONNECT first, otherwise just drop the socket (link loss)
+  void disconnect(bool graceful);
+
+  // Same limits as MqttAsyncClient: at most window QoS 1 PUBLISHes await
+  // their PUBACK, later ones wait in order, and up to capacity are held
+  // across a dropped link
+  void setQos1Limits(size_t window, size_t capacity);
+
+  // QoS 0 is written at once and fails while offline. QoS 1 is queued and
+  // fails only when capacity is reached.
+  bool publish(const char* topic, const uint8_t* payload, size_t len, uint8_t qos = 0);
+  size_t pending() const { return outbound.size(); }
+  const SimQos1Stats& qos1Stats() const { return qos1; }
+  // Blocking SUBSCRIBE / SUBACK exchange, QoS 0
+  bool subscribe(const char* filter, int timeoutMs);
+
+  // Read what is pending (waiting at most waitMs), hand PUBLISHes to handler,
+  // settle PUBACKs, refill the QoS 1 window and send PINGREQ when keep-alive
+  // is due. Returns false (and closes) when the connection is lost or a
+  // PUBACK is overdue.
+  bool poll(int waitMs, SimMqttHandler handler, void* ctx);
+
+private:
+  struct Outbound {
+    std::vector<uint8_t> pkt;
+    uint16_t packetId;
+    uint64_t sentUs;
+  };
+
+  bool sendPacket(const std::vector<uint8_t>& pkt);
+  bool waitPacket(uint8_t expectedType, int timeoutMs);
+  void handleAck(const std::vector<uint8_t>& body);
+  bool sendWaiting();
+
+  int fd;
+  uint16_t keepAliveS;
+  uint64_t lastSendUs;
+  std::vector<uint8_t> rx;
+  bool lastSessionPresent;
+
+  std::deque<Outbound> outbound; // the first inflightCount are in flight, in send order
+  size_t inflightCount;
+  size_t window;
+  size_t capacity;
+  uint16_t lastPacketId;
+  SimQos1Stats qos1;
+};
+
+struct SimBrokerStats {
+  uint64_t connects;
+  uint64_t takeovers;    // CONNECT with a client id already connected
+  uint64_t publishesIn;
+  uint64_t publishesOut; // deliveries to subscribers
+  uint32_t clients;      // currently connected
+};
+
+class SimMqttBroker {
+public:
+  SimMqttBroker();
+  ~SimMqttBroker();
+
+  bool start(uint16_t port);
+  void stop();
+  uint16_t port() const { return boundPort; }
+  SimBrokerStats stats() const;
+
+private:
+  struct Session {
+    int fd;
+    bool connected; // CONNECT received
+    std::string clientId;
+    std::vector<uint8_t> rx;
+    std::vector<std::string> filters;
+  };
+
+  void run();
+  bool handlePacket(size_t index, uint8_t header, const uint8_t* body, size_t len);
+  void route(const std::string& topic, const uint8_t* payload, size_t len);
+
+  int listenFd;
+  uint16_t boundPort;
+  std::atomic<bool> running;
+  std::thread worker;
+  std::vector<Session> sessions;
+  std::set<std::string> persistentIds; // clients that connected with clean session off
+
+  std::atomic<uint64_t> connects;
+  std::atomic<uint64_t> takeovers;
+  std::atomic<uint64_t> publishesIn;
+  std::atomic<uint64_t> publishesOut;
+  std::atomic<uint32_t> clientCount;
+};
+
+// MQTT topic filter match with + and # wildcards
+bool simTopicMatches(const char* filter, const char* topic);
+
+#endif // SIM_MQTT_H
@@ -0,0 +1,107 @@
+#include "sim_net.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+
+uint64_t simNowUs() {
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+int simListen(uint16_t port, uint16_t* boundPort) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1024) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  socklen_t len = sizeof(addr);
+  getsockname(fd, (sockaddr*)&addr, &len);
+  if (boundPort) *boundPort = ntohs(addr.sin_port);
+  return fd;
+}
+
+int simConnect(const char* host, uint16_t port, int timeoutMs) {
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &res) != 0 || res == nullptr) return -1;
+
+  sockaddr_in addr;
+  memcpy(&addr, res->ai_addr, sizeof(addr));
+  freeaddrinfo(res);
+  addr.sin_port = htons(port);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+
+  // Non-blocking connect so the timeout is honoured, then back to blocking
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  int rc = connect(fd, (sockaddr*)&addr, sizeof(addr));
+  if (rc < 0 && errno != EINPROGRESS) {
+    close(fd);
+    return -1;
+  }
+  if (rc < 0) {
+    pollfd p = {fd, POLLOUT, 0};
+    int err = 0;
+    socklen_t errLen = sizeof(err);
+    if (poll(&p, 1, timeoutMs) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errLen) < 0 || err != 0) {
+      close(fd);
+      return -1;
+    }
+  }
+  fcntl(fd, F_SETFL, flags);
+
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+void simSetRecvTimeout(int fd, int timeoutMs) {
+  timeval tv;
+  tv.tv_sec = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+bool simSendAll(int fd, const void* buf, size_t len) {
+  const uint8_t* p = (const uint8_t*)buf;
+  while (len > 0) {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+void simClose(int& fd) {
+  if (fd >= 0) close(fd);
+  fd = -1;
+}
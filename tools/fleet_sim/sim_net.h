@@ -0,0 +1,28 @@
+#ifndef SIM_NET_H
+#define SIM_NET_H
+
+// POSIX socket helpers shared by the fleet simulator pieces.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Monotonic microseconds since the first call. All simulator components
+// share this clock, so timestamps can be compared across threads.
+uint64_t simNowUs();
+
+// Listen on 127.0.0.1:port (0 = ephemeral). Returns the socket, -1 on error.
+// *boundPort receives the actual port.
+int simListen(uint16_t port, uint16_t* boundPort);
+
+// Blocking connect with a timeout. Returns the socket, -1 on error.
+int simConnect(const char* host, uint16_t port, int timeoutMs);
+
+// Receive timeout for blocking reads (0 = none)
+void simSetRecvTimeout(int fd, int timeoutMs);
+
+bool simSendAll(int fd, const void* buf, size_t len);
+
+// Close and mark the descriptor invalid
+void simClose(int& fd);
+
+#endif // SIM_NET_H
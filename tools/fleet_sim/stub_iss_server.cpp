@@ -0,0 +1,111 @@
+#include "stub_iss_server.h"
+#include "sim_net.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+
+// xorshift32, one state per handler thread
+static uint32_t nextRandom(uint32_t& s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+static double unitRandom(uint32_t& s) {
+  return (nextRandom(s) >> 8) / 16777216.0;
+}
+
+StubIssServer::StubIssServer()
+    : listenFd(-1), boundPort(0), faults(), running(false), requestCount(0), droppedCount(0) {}
+
+StubIssServer::~StubIssServer() {
+  stop();
+}
+
+bool StubIssServer::start(uint16_t port, unsigned handlerCount, const StubFaults& f) {
+  listenFd = simListen(port, &boundPort);
+  if (listenFd < 0) return false;
+  faults = f;
+  running = true;
+  // Every handler blocks in accept() on the shared socket
+  for (unsigned i = 0; i < handlerCount; i++) {
+    handlers.push_back(std::thread(&StubIssServer::handlerLoop, this, i));
+  }
+  return true;
+}
+
+void StubIssServer::stop() {
+  if (!running.exchange(false)) return;
+  shutdown(listenFd, SHUT_RDWR); // wakes the accept() calls
+  for (size_t i = 0; i < handlers.size(); i++) handlers[i].join();
+  handlers.clear();
+  simClose(listenFd);
+}
+
+void StubIssServer::handlerLoop(unsigned index) {
+  uint32_t rng = 0x9E3779B9u * (index + 1);
+  while (running) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      if (!running) break;
+      continue;
+    }
+    serve(fd, nextRandom(rng));
+  }
+}
+
+void StubIssServer::serve(int fd, uint32_t rng) {
+  // Read the request head; the body, if any, is ignored
+  char req[1024];
+  size_t len = 0;
+  simSetRecvTimeout(fd, 2000);
+  while (len < sizeof(req) - 1) {
+    ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+    if (n <= 0) break;
+    len += (size_t)n;
+    req[len] = '\0';
+    if (strstr(req, "\r\n\r\n")) break;
+  }
+  requestCount++;
+
+  // Sample generated now; any injected delay counts towards end-to-end latency
+  uint64_t sampleUs = simNowUs();
+  time_t now = time(nullptr);
+
+  uint32_t delayMs = faults.latencyMs;
+  if (faults.jitterMs) delayMs += nextRandom(rng) % (faults.jitterMs + 1);
+  if (delayMs) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+
+  if (unitRandom(rng) < faults.lossRate) {
+    droppedCount++;
+    simClose(fd);
+    return;
+  }
+
+  // ~92 minute orbit, 51.6 degree inclination
+  double phase = fmod((double)now / 5520.0, 1.0) * 2 * M_PI;
+  double lat = 51.6 * sin(phase);
+  double lon = fmod((double)now * 360.0 / 5520.0 - (double)now * 360.0 / 86400.0, 360.0) - 180.0;
+
+  char body[256];
+  int bodyLen = snprintf(body, sizeof(body),
+      "{\"message\": \"success\", \"timestamp\": %ld, \"iss_position\": "
+      "{\"latitude\": \"%.4f\", \"longitude\": \"%.4f\"}, \"sim_us\": %llu}",
+      (long)now, lat, lon, (unsigned long long)sampleUs);
+
+  char head[160];
+  int headLen = snprintf(head, sizeof(head),
+      "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+      "Connection: close\r\n\r\n", bodyLen);
+
+  simSendAll(fd, head, (size_t)headLen);
+  simSendAll(fd, body, (size_t)bodyLen);
+  simClose(fd);
+}
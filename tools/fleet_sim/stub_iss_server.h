@@ -0,0 +1,49 @@
+#ifndef STUB_ISS_SERVER_H
+#define STUB_ISS_SERVER_H
+
+// Local stand-in for http://api.open-notify.org/iss-now.json.
+//
+// Serves the same JSON shape as the real API (coordinates as strings, Unix
+// timestamp) along a simulated orbit, plus a "sim_us" field stamped when the
+// sample is generated, so the simulator can measure end-to-end latency.
+// Responses can be delayed or dropped (connection closed without a reply).
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct StubFaults {
+  double lossRate;   // probability a request is dropped, 0..1
+  uint32_t latencyMs; // delay before each response
+  uint32_t jitterMs;  // extra uniform random delay, 0..jitterMs
+};
+
+class StubIssServer {
+public:
+  StubIssServer();
+  ~StubIssServer();
+
+  // Start handler threads on 127.0.0.1:port (0 = ephemeral)
+  bool start(uint16_t port, unsigned handlers, const StubFaults& faults);
+  void stop();
+
+  uint16_t port() const { return boundPort; }
+  uint64_t requests() const { return requestCount.load(); }
+  uint64_t dropped() const { return droppedCount.load(); }
+
+private:
+  void handlerLoop(unsigned index);
+  void serve(int fd, uint32_t rng);
+
+  int listenFd;
+  uint16_t boundPort;
+  StubFaults faults;
+  std::atomic<bool> running;
+  std::atomic<uint64_t> requestCount;
+  std::atomic<uint64_t> droppedCount;
+  std::vector<std::thread> handlers;
+};
+
+#endif // STUB_ISS_SERVER_H